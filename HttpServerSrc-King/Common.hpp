@@ -19,6 +19,8 @@
 #endif
 
 #include <functional>
+#include <memory>
+#include <type_traits>
 
 #include "util/HttpMethod.hpp"
 #include "util/HttpVersion.hpp"
@@ -26,7 +28,29 @@
 class HttpRequest;
 class HttpResponse;
 
-using NextFn = std::function<void()>;
+// Continues a middleware chain. It only points at the rest of the chain, which
+// outlives the call it's handed to, so it's two pointers and never allocates
+class NextFn
+{
+private:
+    void* mTarget{ nullptr };
+    void (*mInvoke)(void*){ nullptr };
+
+public:
+    NextFn() = default;
+
+    template<typename Fn>
+        requires (!std::is_same_v<std::remove_cv_t<Fn>, NextFn> && std::is_invocable_v<Fn&>)
+    NextFn(Fn& fn)
+        : mTarget(const_cast<void*>(static_cast<const void*>(std::addressof(fn)))),
+          mInvoke([](void* target) { (*static_cast<Fn*>(target))(); }) {};
+
+    void operator()() const {
+        if (this->mInvoke != nullptr)
+            this->mInvoke(this->mTarget);
+    };
+};
+
 using Middleware = std::function<void(const HttpRequest&, HttpResponse&, NextFn)>;
 
 template<typename T>
@@ -0,0 +1,129 @@
+#include <algorithm>
+
+#if defined(__unix__) || defined(__APPLE__)
+    #include <fcntl.h>
+#endif
+
+#include "Connection.hpp"
+#include "HttpServer.hpp"
+
+Connection::Connection(const Socket_t socket, const RequestLimits& limits)
+    : mSocket(socket), mReader(limits)
+{
+#if defined(__unix__) || defined(__APPLE__)
+    // sendFile() queues the file itself instead of reading it into the response
+    this->mOutput.setAcceptsFiles(true);
+#endif
+};
+
+Connection::~Connection()
+{
+    // Nothing may write to the descriptor once it's closed (and possibly reused)
+    this->mWebSocket.reset();
+
+#if defined(_WIN32)
+    ::closesocket(this->mSocket);
+#elif defined(__unix__) || defined(__APPLE__)
+    ::close(this->mSocket);
+#endif
+};
+
+RequestReader::Status Connection::readRequest()
+{
+    const RequestReader::Status status = this->mReader.read(this->mBuffer);
+
+    // Let the client know the body is welcome before it times out waiting
+    if (status == RequestReader::Status::Incomplete
+        && this->mReader.expectsContinue() && !this->b_mContinueSent)
+    {
+        this->b_mContinueSent = true;
+        // Queued behind any responses to earlier pipelined requests
+        this->mOutput.append(sContinueResponse);
+        this->flush();
+    };
+
+    return status;
+};
+
+WebSocketReader::Status Connection::readMessage()
+{
+    return this->mWebSocket->reader.read();
+};
+
+void Connection::nextRequest()
+{
+    this->b_mContinueSent = false;
+    this->mReader.reset(this->mReader.getEnd());
+};
+
+void Connection::compact()
+{
+    const size_t consumed = this->mReader.getStart();
+    if (consumed == 0)
+        return;
+
+    this->mBuffer.erase(0, consumed);
+    this->mReader.rebase(consumed);
+
+    // Let go of whatever a rare large request grew the buffer to once it's been served
+    if (this->mBuffer.empty() && this->mBuffer.capacity() > sMaxRetainedSize)
+        this->mBuffer = std::string{};
+};
+
+long Connection::receive()
+{
+    if (this->mWebSocket != nullptr)
+    {
+        WebSocketReader& reader = this->mWebSocket->reader;
+        const std::span<uint8_t> space = reader.prepare();
+#if defined(_WIN32)
+        const long bytesReceived = recv(this->mSocket, reinterpret_cast<char*>(space.data()), static_cast<int>(space.size()), 0);
+#elif defined(__unix__) || defined(__APPLE__)
+        const long bytesReceived = read(this->mSocket, space.data(), space.size());
+#endif
+        if (bytesReceived > 0)
+            reader.commit(static_cast<size_t>(bytesReceived));
+
+        return bytesReceived;
+    };
+
+    const size_t size = this->mBuffer.size();
+    if (this->mBuffer.capacity() - size < sMinReadSize)
+        this->mBuffer.reserve(std::max(this->mBuffer.capacity() * 2, sInitialBufferSize));
+
+    // Reads straight into the spare capacity, which is never zero-filled first
+    long bytesReceived = 0;
+    this->mBuffer.resize_and_overwrite(this->mBuffer.capacity(), [&](char* data, const size_t capacity) {
+#if defined(_WIN32)
+        bytesReceived = recv(this->mSocket, data + size, static_cast<int>(capacity - size), 0);
+#elif defined(__unix__) || defined(__APPLE__)
+        bytesReceived = read(this->mSocket, data + size, capacity - size);
+#endif
+        return size + std::max(0L, bytesReceived);
+    });
+
+    return bytesReceived;
+};
+
+bool Connection::flush()
+{
+    if (this->mOutput.empty() || this->mIoUringLoop != nullptr)
+        return true;
+
+    if (this->mOutput.writeTo(this->mSocket) != OutputQueue::WriteStatus::Failed)
+        return true;
+
+    this->mOutput.clear();
+    return false;
+};
+
+void Connection::setBlocking(const bool blocking) const
+{
+#if defined(_WIN32)
+    u_long mode = blocking ? 0 : 1;
+    ioctlsocket(this->mSocket, FIONBIO, &mode);
+#elif defined(__unix__) || defined(__APPLE__)
+    const int flags = fcntl(this->mSocket, F_GETFL, 0);
+    fcntl(this->mSocket, F_SETFL, blocking ? (flags & ~O_NONBLOCK) : (flags | O_NONBLOCK));
+#endif
+};
@@ -0,0 +1,83 @@
+#ifndef CONNECTION_HPP
+#define CONNECTION_HPP
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <string_view>
+
+#include "Common.hpp"
+#include "OutputQueue.hpp"
+#include "RequestReader.hpp"
+#include "WebSocketReader.hpp"
+
+struct WebSocketSession;
+
+class EventLoop;
+class IoUringLoop;
+
+class Connection : public std::enable_shared_from_this<Connection>
+{
+    friend class EventLoop;
+    friend class IoUringLoop;
+    friend class HttpServer;
+
+private:
+    static constexpr size_t sInitialBufferSize = 4096;
+    static constexpr size_t sMinReadSize = 1024;
+    static constexpr size_t sMaxRetainedSize = 65536;
+    static constexpr std::string_view sContinueResponse = "HTTP/1.1 100 Continue\r\n\r\n";
+
+    bool b_mContinueSent{ false };
+
+protected:
+    Socket_t mSocket{ 0 };
+    EventLoop* mEventLoop{ nullptr }; // Loop the socket is registered with, if any
+    IoUringLoop* mIoUringLoop{ nullptr };
+    std::string mBuffer{};
+    OutputQueue mOutput{};
+    RequestReader mReader{};
+    size_t mRequestCount{ 0 };
+    // Set once the connection is upgraded, frames are read instead of requests from then on
+    std::unique_ptr<WebSocketSession> mWebSocket{};
+
+    // Set while a worker owns the connection, the event loop leaves it alone until rearmed
+    std::atomic<bool> b_mIsBusy{ false };
+    // Released while output was still queued, it's dropped once the output is written
+    bool b_mIsClosing{ false };
+    std::chrono::steady_clock::time_point mLastActivity{ std::chrono::steady_clock::now() };
+
+public:
+    explicit Connection(Socket_t socket, const RequestLimits& limits = {});
+    ~Connection();
+
+    Connection(const Connection&) = delete;
+    Connection& operator=(const Connection&) = delete;
+
+    [[nodiscard]] Socket_t getSocket() const { return this->mSocket; };
+    [[nodiscard]] std::string& getBuffer() { return this->mBuffer; };
+
+    // Frames the current request from what has been buffered so far
+    RequestReader::Status readRequest();
+    [[nodiscard]] std::string_view getRequest() const { return this->mReader.getRequest(this->mBuffer); };
+    // Frames the next message of an upgraded connection from what has been buffered so far
+    WebSocketReader::Status readMessage();
+    // Moves on to the request following the current complete one
+    void nextRequest();
+    // Drops every byte before the current request from the buffer
+    void compact();
+
+    // Reads once from the socket into the buffer, growing it geometrically (the frame decoder's
+    // buffer once upgraded), returns the read() result
+    long receive();
+    // Writes out the responses queued since the last flush as far as the socket takes them, the event
+    // loop writes the rest once it's writable. io_uring connections are left alone as their loop submits
+    // the output once the handlers return. False once the peer stopped accepting data
+    bool flush();
+    // Output is queued that the socket didn't take yet
+    [[nodiscard]] bool isWritePending() const { return this->mIoUringLoop == nullptr && !this->mOutput.empty(); };
+    void setBlocking(bool blocking) const;
+};
+
+#endif //CONNECTION_HPP
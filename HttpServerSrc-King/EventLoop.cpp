@@ -0,0 +1,303 @@
+#include "EventLoop.hpp"
+#include "WebSocket.hpp"
+
+#if defined(__linux__)
+
+#include <array>
+#include <cerrno>
+#include <ranges>
+#include <stdexcept>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+
+constexpr uint32_t sConnectionEvents = EPOLLIN | EPOLLRDHUP | EPOLLET | EPOLLONESHOT;
+constexpr uint32_t sWriteEvents = EPOLLOUT | EPOLLET | EPOLLONESHOT;
+constexpr int sSweepIntervalMs = 1000;
+
+EventLoop::EventLoop(const Socket_t serverSocket, DispatchFn dispatch,
+    const std::chrono::steady_clock::duration idleTimeout, const RequestLimits& limits)
+    : mIdleTimeout(idleTimeout), mLimits(limits), mServerSocket(serverSocket), mDispatch(std::move(dispatch))
+{
+    this->mEpollFd = epoll_create1(EPOLL_CLOEXEC);
+    if (this->mEpollFd < 0) {
+        throw std::runtime_error("Failed to create epoll instance");
+    };
+
+    this->mWakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (this->mWakeFd < 0) {
+        throw std::runtime_error("Failed to create eventfd");
+    };
+
+    const int flags = fcntl(this->mServerSocket, F_GETFL, 0);
+    fcntl(this->mServerSocket, F_SETFL, flags | O_NONBLOCK);
+
+    // The listening socket is tagged with nullptr, the wake fd with the loop itself
+    epoll_event event{};
+    event.events = EPOLLIN | EPOLLET;
+    event.data.ptr = nullptr;
+    if (epoll_ctl(this->mEpollFd, EPOLL_CTL_ADD, this->mServerSocket, &event) < 0) {
+        throw std::runtime_error("Failed to watch server socket");
+    };
+
+    event.events = EPOLLIN;
+    event.data.ptr = this;
+    epoll_ctl(this->mEpollFd, EPOLL_CTL_ADD, this->mWakeFd, &event);
+};
+
+EventLoop::~EventLoop()
+{
+    {
+        std::unique_lock lock(this->mConnectionsMutex);
+        this->mConnections.clear();
+    };
+
+    if (this->mWakeFd >= 0)
+        ::close(this->mWakeFd);
+
+    if (this->mEpollFd >= 0)
+        ::close(this->mEpollFd);
+};
+
+void EventLoop::run()
+{
+    this->b_mIsRunning = true;
+
+    std::array<epoll_event, sMaxEvents> events{};
+    while (this->b_mIsRunning)
+    {
+        const int count = epoll_wait(this->mEpollFd, events.data(), sMaxEvents, sSweepIntervalMs);
+        if (count < 0)
+        {
+            if (errno == EINTR)
+                continue;
+
+            break;
+        };
+
+        for (int i = 0; i < count; ++i)
+        {
+            void* tag = events[i].data.ptr;
+            if (tag == nullptr)
+            {
+                this->acceptConnections();
+                continue;
+            };
+
+            if (tag == this)
+            {
+                uint64_t value;
+                while (read(this->mWakeFd, &value, sizeof(value)) > 0) {};
+                continue;
+            };
+
+            // Connections with queued output were only armed for writing
+            if (auto& connection = *static_cast<Connection*>(tag); !connection.mOutput.empty())
+                this->writeConnection(connection);
+            else this->readConnection(connection);
+        };
+
+        // Only once the batch is handled, a connection it frees may still be tagged in it
+        this->closeIdleConnections();
+    };
+};
+
+void EventLoop::stop()
+{
+    this->b_mIsRunning = false;
+
+    constexpr uint64_t value = 1;
+    [[maybe_unused]] const auto _ = write(this->mWakeFd, &value, sizeof(value));
+};
+
+void EventLoop::rearm(Connection& connection) const
+{
+    connection.mLastActivity = std::chrono::steady_clock::now();
+    connection.b_mIsBusy.store(false, std::memory_order_release);
+
+    // Nothing else is read until what the socket didn't take is written
+    epoll_event event{};
+    event.events = connection.mOutput.empty() ? sConnectionEvents : sWriteEvents;
+    event.data.ptr = &connection;
+
+    epoll_ctl(this->mEpollFd, EPOLL_CTL_MOD, connection.mSocket, &event);
+};
+
+void EventLoop::release(Connection& connection)
+{
+    if (!connection.mOutput.empty())
+    {
+        connection.b_mIsClosing = true;
+        this->rearm(connection);
+        return;
+    };
+
+    // The socket itself is closed once the last owner drops the connection
+    const Socket_t socket = connection.mSocket;
+    epoll_ctl(this->mEpollFd, EPOLL_CTL_DEL, socket, nullptr);
+
+    std::unique_lock lock(this->mConnectionsMutex);
+    this->mConnections.erase(socket);
+};
+
+void EventLoop::acceptConnections()
+{
+    while (this->b_mIsRunning)
+    {
+        sockaddr_in clientAddress{};
+        socklen_t addressLength = sizeof(clientAddress);
+
+        const Socket_t clientSocket = accept4(this->mServerSocket, reinterpret_cast<sockaddr*>(&clientAddress),
+            &addressLength, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (clientSocket < 0)
+        {
+            if (errno == EINTR || errno == ECONNABORTED)
+                continue;
+
+            break; // EAGAIN, the backlog is drained
+        };
+
+        const auto& connection = std::make_shared<Connection>(clientSocket, this->mLimits);
+        connection->mEventLoop = this;
+        {
+            std::unique_lock lock(this->mConnectionsMutex);
+            this->mConnections[clientSocket] = connection;
+        };
+
+        epoll_event event{};
+        event.events = sConnectionEvents;
+        event.data.ptr = connection.get();
+
+        if (epoll_ctl(this->mEpollFd, EPOLL_CTL_ADD, clientSocket, &event) < 0)
+            this->release(*connection);
+    };
+};
+
+void EventLoop::readConnection(Connection& connection)
+{
+    if (connection.mWebSocket != nullptr)
+    {
+        this->readWebSocket(connection);
+        return;
+    };
+
+    // Edge-triggered, so the socket is drained until EAGAIN unless a request
+    // completes first, rearming reports whatever is still unread
+    RequestReader::Status status = connection.readRequest();
+    while (status == RequestReader::Status::Incomplete)
+    {
+        const long bytesReceived = connection.receive();
+        if (bytesReceived > 0)
+        {
+            status = connection.readRequest();
+            continue;
+        };
+
+        if (bytesReceived < 0 && errno == EINTR)
+            continue;
+
+        if (bytesReceived < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            break;
+
+        this->release(connection);
+        return;
+    };
+
+    connection.mLastActivity = std::chrono::steady_clock::now();
+    if (status != RequestReader::Status::Incomplete)
+    {
+        // Workers answer malformed or oversized requests as well
+        connection.b_mIsBusy.store(true, std::memory_order_relaxed);
+        this->mDispatch(connection.shared_from_this());
+        return;
+    };
+
+    this->rearm(connection);
+};
+
+void EventLoop::writeConnection(Connection& connection)
+{
+    if (!connection.flush() || (connection.mOutput.empty() && connection.b_mIsClosing))
+    {
+        this->release(connection);
+        return;
+    };
+
+    if (!connection.mOutput.empty())
+    {
+        this->rearm(connection);
+        return;
+    };
+
+    // Requests held back while the output was blocked are served now, along with whatever arrived meanwhile
+    this->readConnection(connection);
+};
+
+void EventLoop::readWebSocket(Connection& connection)
+{
+    // Drained the same way, a worker is only woken for a complete message or a peer that left
+    WebSocketReader::Status status = connection.readMessage();
+    while (status == WebSocketReader::Status::Incomplete)
+    {
+        const long bytesReceived = connection.receive();
+        if (bytesReceived > 0)
+        {
+            status = connection.readMessage();
+            continue;
+        };
+
+        if (bytesReceived < 0 && errno == EINTR)
+            continue;
+
+        if (bytesReceived < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            break;
+
+        connection.mWebSocket->isClosed = true;
+        break;
+    };
+
+    connection.mLastActivity = std::chrono::steady_clock::now();
+    if (status != WebSocketReader::Status::Incomplete || connection.mWebSocket->isClosed)
+    {
+        connection.b_mIsBusy.store(true, std::memory_order_relaxed);
+        this->mDispatch(connection.shared_from_this());
+        return;
+    };
+
+    this->rearm(connection);
+};
+
+void EventLoop::closeIdleConnections()
+{
+    const auto& now = std::chrono::steady_clock::now();
+    if (now - this->mLastSweep < std::chrono::milliseconds(sSweepIntervalMs))
+        return;
+
+    this->mLastSweep = now;
+
+    std::vector<std::shared_ptr<Connection>> expired;
+    {
+        std::unique_lock lock(this->mConnectionsMutex);
+        for (const auto& connection : this->mConnections | std::views::values)
+        {
+            // WebSockets stay open for as long as their peer wants, idle or not
+            if (connection->b_mIsBusy.load(std::memory_order_acquire)
+                || connection->mWebSocket != nullptr
+                || now - connection->mLastActivity < this->mIdleTimeout)
+                continue;
+
+            expired.push_back(connection);
+        };
+    };
+
+    // A peer that stopped reading loses whatever is still queued for it
+    for (const auto& connection : expired)
+    {
+        connection->mOutput.clear();
+        this->release(*connection);
+    };
+};
+
+#endif
@@ -0,0 +1,68 @@
+#ifndef EVENTLOOP_HPP
+#define EVENTLOOP_HPP
+
+#if defined(__linux__)
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+#include "Common.hpp"
+#include "Connection.hpp"
+
+// Edge-triggered epoll reactor, owns every accepted connection and only
+// hands a connection to the dispatcher once a complete request has arrived
+// (or, once upgraded, a complete WebSocket message). Responses a socket
+// doesn't take right away are finished by the loop once it's writable
+class EventLoop
+{
+public:
+    using DispatchFn = std::function<void(std::shared_ptr<Connection>)>;
+
+private:
+    static constexpr int sMaxEvents = 256;
+
+    std::atomic<bool> b_mIsRunning{ false };
+    std::chrono::steady_clock::duration mIdleTimeout{};
+    RequestLimits mLimits{};
+    std::chrono::steady_clock::time_point mLastSweep{};
+    std::unordered_map<Socket_t, std::shared_ptr<Connection>> mConnections{};
+    std::mutex mConnectionsMutex{};
+
+protected:
+    int mEpollFd{ -1 };
+    int mWakeFd{ -1 };
+    Socket_t mServerSocket{ 0 };
+    DispatchFn mDispatch{};
+
+public:
+    EventLoop(Socket_t serverSocket, DispatchFn dispatch,
+        std::chrono::steady_clock::duration idleTimeout, const RequestLimits& limits);
+    ~EventLoop();
+
+    EventLoop(const EventLoop&) = delete;
+    EventLoop& operator=(const EventLoop&) = delete;
+
+    void run();
+    void stop();
+
+    // Hands a dispatched connection back to the loop to wait for its next request,
+    // or to finish writing output the socket didn't take yet
+    void rearm(Connection& connection) const;
+    // Drops the connection, once its queued output is written
+    void release(Connection& connection);
+
+private:
+    void acceptConnections();
+    void readConnection(Connection& connection);
+    void writeConnection(Connection& connection);
+    void readWebSocket(Connection& connection);
+    void closeIdleConnections();
+};
+
+#endif
+
+#endif //EVENTLOOP_HPP
@@ -1,44 +1,65 @@
+#include <algorithm>
+#include <stdexcept>
+
 #include "HttpRequest.hpp"
-HttpRequest::HttpRequest(Socket_t clientSocket, const std::string& data)
+#include "util/HttpScanner.hpp"
+
+inline std::string_view trim(std::string_view value)
 {
-    this->mClientSocket = clientSocket;
+    while (!value.empty() && (value.front() == ' ' || value.front() == '\t'))
+        value.remove_prefix(1);
+
+    while (!value.empty() && (value.back() == ' ' || value.back() == '\t'))
+        value.remove_suffix(1);
+
+    return value;
+};
 
-    size_t lpos = 0, rpos = 0;
-    rpos = data.find("\r\n", lpos);
-    if (rpos == std::string::npos)
+// Next space separated token of the start line, removed from it
+inline std::string_view nextToken(std::string_view& line)
+{
+    const size_t start = line.find_first_not_of(' ');
+    if (start == std::string_view::npos)
     {
-        throw std::invalid_argument("Could not find request start line");
+        line = {};
+        return {};
     };
 
-    std::string headers, body, startLine = data.substr(lpos, rpos - lpos);
+    line.remove_prefix(start);
+    const size_t end = std::min(line.find(' '), line.size());
+    const std::string_view token = line.substr(0, end);
+    line.remove_prefix(end);
 
-    lpos = rpos + 2;
-    rpos = data.find("\r\n\r\n", lpos);
-    if (rpos != std::string::npos)
-    {
-        headers = data.substr(lpos, rpos - lpos);
+    return token;
+};
 
-        lpos = rpos + 4, rpos = data.length();
-        if (lpos < rpos)
-        {
-            body = data.substr(lpos, rpos - lpos);
-        };
+HttpRequest::HttpRequest(const Socket_t clientSocket, const std::string_view data)
+    : mData(data), mClientSocket(clientSocket)
+{
+    const size_t lineEnd = HttpScanner::findLineEnd(data, 0);
+    if (lineEnd == std::string_view::npos || !data.substr(lineEnd).starts_with("\r\n"))
+    {
+        throw std::invalid_argument("Could not find request start line");
     };
 
     // Parsing start line
-    std::istringstream iss{ startLine };
-
-    std::string method, path, version;
-    iss >> method >> path >> version;
+    std::string_view startLine = data.substr(0, lineEnd);
+    const std::string_view method = nextToken(startLine);
+    const std::string_view target = nextToken(startLine);
+    const std::string_view version = nextToken(startLine);
 
-    if (!iss.good() && !iss.eof())
+    if (version.empty() || !trim(startLine).empty())
     {
         throw std::invalid_argument("Invalid start line format");
     };
 
-    this->mPath = path;
     this->mMethod = HttpMethod::fromString(method);
 
+    const size_t queryStart = target.find('?');
+    this->mPath = target.substr(0, queryStart);
+    if (queryStart != std::string_view::npos)
+        this->mQuery = target.substr(queryStart + 1);
+
     const auto& httpVersion = HttpVersion::fromString(version);
     if (httpVersion != HttpVersion::HTTP_1_1) {
         throw std::logic_error("HTTP version not supported");
@@ -46,45 +67,160 @@ HttpRequest::HttpRequest(Socket_t clientSocket, const std::string& data)
 
     this->mVersion = httpVersion;
 
-    // Parsing headers
-    iss.clear();
-    iss.str(headers);
+    // Parsing headers, up to the blank line that starts the body
+    this->mHeaders.reserve(sInitialHeaders);
 
-    std::string line;
-    while (std::getline(iss, line))
+    size_t position = lineEnd + 2;
+    while (position < data.size())
     {
-        std::string key, value;
-        std::istringstream header{ line };
+        const size_t colon = HttpScanner::findHeaderName(data, position);
+        const size_t end = colon != std::string_view::npos && data[colon] == ':'
+            ? HttpScanner::findLineEnd(data, colon) : colon;
+        if (end == std::string_view::npos)
+            break;
+
+        if (!data.substr(end).starts_with("\r\n"))
+        {
+            throw std::invalid_argument("Invalid character in header line");
+        };
+
+        if (end == position)
+        {
+            this->mBody = data.substr(end + 2);
+            break;
+        };
+
+        if (colon != end)
+        {
+            const std::string_view name = trim(data.substr(position, colon - position));
+            this->mHeaders.push_back({ name, trim(data.substr(colon + 1, end - colon - 1)), HeaderName::fromString(name) });
+        };
+
+        position = end + 2;
+    };
+
+    this->indexHeaders();
+};
+
+HttpRequest::HttpRequest(const HttpRequest& other)
+{
+    this->assign(other, std::string{ other.mData });
+};
+
+HttpRequest& HttpRequest::operator=(const HttpRequest& other)
+{
+    if (this != &other)
+        this->assign(other, std::string{ other.mData });
+
+    return *this;
+};
+
+HttpRequest::HttpRequest(HttpRequest&& other) noexcept
+{
+    this->assign(other, std::move(other.mStorage));
+};
+
+HttpRequest& HttpRequest::operator=(HttpRequest&& other) noexcept
+{
+    if (this != &other)
+        this->assign(other, std::move(other.mStorage));
+
+    return *this;
+};
+
+void HttpRequest::assign(const HttpRequest& other, std::string storage)
+{
+    this->mStorage = std::move(storage);
+    this->mData = this->mStorage.empty() ? other.mData : std::string_view{ this->mStorage };
 
-        std::getline(header, key, ':');
-        std::getline(header, value);
+    // Views keep their offset into the request, only the bytes they point at move
+    const char* base = other.mData.data();
+    const auto& rebase = [this, base](const std::string_view view) {
+        if (view.data() == nullptr)
+            return view;
 
-        std::erase_if(key, [](const char& c) { return std::isspace(c); });
-        std::erase_if(value, [](const char& c) { return std::isspace(c); });
+        return std::string_view{ this->mData.data() + (view.data() - base), view.size() };
+    };
+
+    this->mPath = rebase(other.mPath);
+    this->mQuery = rebase(other.mQuery);
+    this->mBody = rebase(other.mBody);
+    this->mMethod = other.mMethod;
+    this->mVersion = other.mVersion;
+    this->mClientSocket = other.mClientSocket;
+    this->mOriginalPath = other.mOriginalPath;
+
+    this->mHeaders.clear();
+    this->mHeaders.reserve(other.mHeaders.size());
+    for (const auto& [name, value, id] : other.mHeaders)
+        this->mHeaders.push_back({ rebase(name), rebase(value), id });
+
+    this->mKnownHeaders = other.mKnownHeaders;
+    this->mOtherHeaders = other.mOtherHeaders;
+};
 
-        this->mHeaders[key] = value;
+void HttpRequest::indexHeaders()
+{
+    size_t others = 0;
+    for (size_t i = 0; i < this->mHeaders.size(); ++i)
+    {
+        const HeaderName::Id id = this->mHeaders[i].id;
+        if (id == HeaderName::Unknown)
+            ++others;
+        else if (this->mKnownHeaders[id] == 0)
+            this->mKnownHeaders[id] = static_cast<uint32_t>(i + 1);
     };
 
-    this->mBody = body;
+    if (others == 0)
+        return;
+
+    // At most half full so probes stay short
+    size_t capacity = 8;
+    while (capacity < others * 2)
+        capacity *= 2;
+
+    this->mOtherHeaders.assign(capacity, 0);
+    for (size_t i = 0; i < this->mHeaders.size(); ++i)
+    {
+        const auto& [name, value, id] = this->mHeaders[i];
+        if (id != HeaderName::Unknown)
+            continue;
+
+        size_t slot = HeaderName::hash(name) & (capacity - 1);
+        while (this->mOtherHeaders[slot] != 0 && !HeaderName::equals(this->mHeaders[this->mOtherHeaders[slot] - 1].name, name))
+            slot = (slot + 1) & (capacity - 1);
+
+        if (this->mOtherHeaders[slot] == 0)
+            this->mOtherHeaders[slot] = static_cast<uint32_t>(i + 1);
+    };
 };
 
-std::optional<std::string> HttpRequest::getHeader(const std::string& name) const {
-    std::string input{name};
-    std::ranges::transform(input, input.begin(),
-        [](const unsigned char c){ return std::tolower(c); });
+std::optional<std::string_view> HttpRequest::getHeader(const std::string_view name) const {
+    if (const HeaderName::Id id = HeaderName::fromString(name);
+        id != HeaderName::Unknown)
+        return this->getHeader(id);
 
-    for (auto& [key, value] : this->mHeaders) {
-        std::string kLower{key};
-        std::ranges::transform(kLower, kLower.begin(),
-            [](const unsigned char c){ return std::tolower(c); });
+    if (this->mOtherHeaders.empty())
+        return std::nullopt;
 
-        if (kLower == input)
-            return value;
+    const size_t mask = this->mOtherHeaders.size() - 1;
+    for (size_t slot = HeaderName::hash(name) & mask; this->mOtherHeaders[slot] != 0; slot = (slot + 1) & mask)
+    {
+        if (const auto& header = this->mHeaders[this->mOtherHeaders[slot] - 1];
+            HeaderName::equals(header.name, name))
+            return header.value;
     };
 
     return std::nullopt;
 };
 
+std::optional<std::string_view> HttpRequest::getHeader(const HeaderName::Id id) const {
+    if (id >= HeaderName::Unknown || this->mKnownHeaders[id] == 0)
+        return std::nullopt;
+
+    return this->mHeaders[this->mKnownHeaders[id] - 1].value;
+};
+
 std::string HttpRequest::getRemoteAddr() const
 {
     sockaddr_in addr{};
@@ -1,40 +1,74 @@
 #ifndef HTTPREQUEST_HPP
 #define HTTPREQUEST_HPP
 
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
 #include <unordered_map>
-#include <sstream>
+#include <vector>
 
+#include "util/HeaderName.hpp"
 #include "util/HttpMethod.hpp"
 #include "util/HttpVersion.hpp"
 
 #include "Common.hpp"
 
 typedef std::unordered_map<std::string, std::string> HeadersMap_t;
+
+struct HttpHeader {
+    std::string_view name{};
+    std::string_view value{};
+    HeaderName::Id id{ HeaderName::Unknown };
+};
+typedef std::vector<HttpHeader> HeadersList_t;
+
+// Parsed in place: path, query, headers and body are views into the request
+// bytes. A request built from a buffer borrows it for as long as it's handled,
+// copies own their bytes so they can outlive it (e.g. in a WebSocket)
 class HttpRequest
 {
     friend class HttpServer;
 
 private:
-    std::string mPath{};
-    std::string mBody{};
+    static constexpr size_t sInitialHeaders = 32;
+
+    std::string mStorage{};
+    std::string_view mData{};
+    std::string_view mPath{};
+    std::string_view mQuery{};
+    std::string_view mBody{};
     HttpMethod::Method mMethod{ HttpMethod::GET };
     HttpVersion::Version mVersion{ HttpVersion::HTTP_1_1 };
-    HeadersMap_t mHeaders{};
+    HeadersList_t mHeaders{};
+    // Positions in mHeaders plus one, zero when absent: a slot for each well-known
+    // header and an open-addressed table keyed by HeaderName::hash for the rest
+    std::array<uint32_t, HeaderName::Unknown> mKnownHeaders{};
+    std::vector<uint32_t> mOtherHeaders{};
 
 protected:
     Socket_t mClientSocket{ 0 };
     std::string mOriginalPath{};
 
 public:
-    HttpRequest(Socket_t clientSocket, const std::string& data);
+    HttpRequest(Socket_t clientSocket, std::string_view data);
     ~HttpRequest() = default;
 
-    [[nodiscard]] const std::string& getPath() const { return this->mPath; };
+    HttpRequest(const HttpRequest& other);
+    HttpRequest& operator=(const HttpRequest& other);
+    HttpRequest(HttpRequest&& other) noexcept;
+    HttpRequest& operator=(HttpRequest&& other) noexcept;
+
+    [[nodiscard]] std::string_view getPath() const { return this->mPath; };
+    [[nodiscard]] std::string_view getQuery() const { return this->mQuery; };
     [[nodiscard]] const std::string& getOriginalPath() const { return this->mOriginalPath; };
-    [[nodiscard]] const std::string& getBody() const { return this->mBody; };
+    [[nodiscard]] std::string_view getBody() const { return this->mBody; };
 
-    [[nodiscard]] const HeadersMap_t& getHeaders() const { return this->mHeaders; };
-    std::optional<std::string> getHeader(const std::string& name) const;
+    [[nodiscard]] const HeadersList_t& getHeaders() const { return this->mHeaders; };
+    // Case-insensitive, the first header with that name
+    [[nodiscard]] std::optional<std::string_view> getHeader(std::string_view name) const;
+    [[nodiscard]] std::optional<std::string_view> getHeader(HeaderName::Id id) const;
 
     [[nodiscard]] std::string getRemoteAddr() const;
     [[nodiscard]] HttpMethod::Method getMethod() const { return this->mMethod; };
@@ -42,6 +76,9 @@ public:
 
 private:
     void setOriginalPath(const std::string& path) { this->mOriginalPath = path; };
+    // Takes over other's fields with every view moved onto storage, or still onto other's bytes when empty
+    void assign(const HttpRequest& other, std::string storage);
+    void indexHeaders();
 };
 
 #endif // !HTTPREQUEST_HPP
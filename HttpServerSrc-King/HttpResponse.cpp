@@ -1,13 +1,176 @@
+#include <cstdio>
 #include <fstream>
+#include <random>
+
+#if defined(__unix__) || defined(__APPLE__)
+    #include <fcntl.h>
+    #include <sys/stat.h>
+#endif
 
 #include "HttpResponse.hpp"
 #include "HttpServer.hpp"
+#include "util/ETag.hpp"
+#include "util/HttpDate.hpp"
+
+inline void appendBody(OutputQueue& output, const std::shared_ptr<const std::string>& data, const size_t offset, const size_t length)
+{
+    output.append(data, offset, length);
+};
+
+inline void appendBody(OutputQueue& output, const std::shared_ptr<FileHandle>& file, const size_t offset, const size_t length)
+{
+    output.appendFile(file, offset, length);
+};
+
+// Separates the parts of a multipart/byteranges body, random so it can't turn up in one of them
+inline std::string makeBoundary()
+{
+    thread_local std::mt19937_64 generator{ std::random_device{}() };
+
+    char boundary[17];
+    std::snprintf(boundary, sizeof(boundary), "%016llx", static_cast<unsigned long long>(generator()));
+    return boundary;
+};
 
 bool HttpResponse::send(std::string data)
 {
-    const size_t length = data.length();
+    if (const auto encoding = this->negotiateEncoding(data.length());
+        encoding != Compression::Identity)
+    {
+        if (auto compressed = Compression::compress(data, encoding);
+            compressed.has_value() && compressed->length() < data.length())
+        {
+            this->setHeader("Content-Encoding", Compression::toString(encoding));
+            data = std::move(compressed.value());
+
+            // The same bytes aren't guaranteed next time, a strong tag can't stay
+            if (const auto& etag = this->mHeaders.find("ETag");
+                etag != this->mHeaders.end() && etag->second.starts_with('"'))
+                etag->second.insert(0, "W/");
+        };
+    };
+
+    if (!this->prepareBody(data.length()))
+        data = "";
+
+    // The body is handed over as is, it's never copied behind the headers
+    return this->sendToSocket(this->toHttpString(), std::move(data));
+};
+
+bool HttpResponse::send(std::shared_ptr<const std::string> data)
+{
+    if (!data)
+        return this->send();
+
+    const size_t size = data->size();
+    return this->sendBody(data, size);
+};
+
+template<typename Body>
+bool HttpResponse::sendBody(const Body& body, const size_t size)
+{
+    if (true == this->mHeadersSent)
+        return false;
+
+    const auto& ranges = this->selectRanges(size);
+    if (ranges.has_value() && ranges->empty())
+    {
+        this->mStatusCode = HttpStatus::RangeNotSatisfiable;
+        this->setHeader("Content-Range", "bytes */" + std::to_string(size));
+        this->removeHeader("Content-Encoding");
+        return this->send();
+    };
+
+    OutputQueue local;
+    OutputQueue& output = this->mOutputBuffer != nullptr ? *this->mOutputBuffer : local;
+
+    if (!ranges.has_value())
+    {
+        const bool hasBody = this->prepareBody(size);
+        output.append(this->toHttpString());
+        if (hasBody)
+            appendBody(output, body, 0, size);
+    }
+    else if (ranges->size() == 1)
+    {
+        const ByteRange::Range& range = ranges->front();
+        this->mStatusCode = HttpStatus::PartialContent;
+        this->setHeader("Content-Range", ByteRange::toString(range, size));
+
+        const bool hasBody = this->prepareBody(range.length());
+        output.append(this->toHttpString());
+        if (hasBody)
+            appendBody(output, body, range.first, range.length());
+    }
+    else
+    {
+        // Every part carries the Content-Type and Content-Range a single range would have had
+        const auto& contentType = this->mHeaders.find("Content-Type");
+        const std::string& type = contentType != this->mHeaders.end() ? contentType->second : "application/octet-stream";
+        const std::string& boundary = makeBoundary();
+
+        std::vector<std::string> heads;
+        size_t length = 0;
+        for (const auto& range : ranges.value())
+        {
+            heads.push_back("\r\n--" + boundary + "\r\nContent-Type: " + type
+                + "\r\nContent-Range: " + ByteRange::toString(range, size) + "\r\n\r\n");
+            length += heads.back().size() + range.length();
+        };
+
+        const std::string& tail = "\r\n--" + boundary + "--\r\n";
+        length += tail.size();
+
+        this->mStatusCode = HttpStatus::PartialContent;
+        this->setHeader("Content-Type", "multipart/byteranges; boundary=" + boundary);
+
+        const bool hasBody = this->prepareBody(length);
+        output.append(this->toHttpString());
+        if (hasBody)
+        {
+            for (size_t i = 0; i < heads.size(); ++i)
+            {
+                output.append(std::move(heads[i]));
+                appendBody(output, body, ranges.value()[i].first, ranges.value()[i].length());
+            };
+
+            output.append(tail);
+        };
+    };
+
+    if (&output == &local)
+        local.writeTo(this->mClientSocket);
+
+    this->mHeadersSent = true;
+    return true;
+};
+
+std::optional<std::vector<ByteRange::Range>> HttpResponse::selectRanges(const size_t size)
+{
+    if (HttpStatus::OK != this->mStatusCode)
+        return std::nullopt;
+
+    this->setHeader("Accept-Ranges", "bytes");
+    if (this->mRange.empty())
+        return std::nullopt;
+
+    // The parts the client has left only fit onto what it has if the validator is still exactly the same
+    if (!this->mIfRange.empty())
+    {
+        const char* validator = this->mIfRange.starts_with('"') ? "ETag" : "Last-Modified";
+        const auto& current = this->mHeaders.find(validator);
+        if (current == this->mHeaders.end() || current->second != this->mIfRange)
+            return std::nullopt;
+    };
+
+    return ByteRange::parse(this->mRange, size);
+};
+
+bool HttpResponse::prepareBody(const size_t length)
+{
     this->setHeader("Content-Length", std::to_string(length));
 
+    bool hasBody = true;
     if (
         (this->mStatusCode >= 100 && this->mStatusCode < 200)
         || HttpStatus::NoContent == this->mStatusCode
@@ -16,23 +179,56 @@ bool HttpResponse::send(std::string data)
         this->removeHeader("Content-Type");
         this->removeHeader("Content-Length");
         this->removeHeader("Transfer-Encoding");
-        data = "";
+        hasBody = false;
     };
 
     if (HttpStatus::ResetContent == this->mStatusCode) {
         this->removeHeader("Transfer-Encoding");
-        data = "";
+        hasBody = false;
     };
 
-    std::ostringstream stream = this->toHttpString();
-    if (const auto& requestMethod = this->mRequest.getMethod();
-        requestMethod != HttpMethod::HEAD &&
-        requestMethod != HttpMethod::CONNECT
+    if (const auto& requestMethod = this->mRequestMethod;
+        requestMethod == HttpMethod::HEAD ||
+        requestMethod == HttpMethod::CONNECT
     ) {
-        stream << "\r\n" << data;
+        hasBody = false;
     };
 
-    return this->sendToSocket(stream.str());
+    return hasBody;
+};
+
+Compression::Encoding HttpResponse::negotiateEncoding(const size_t length)
+{
+    const auto& contentType = this->mHeaders.find("Content-Type");
+    if (
+        length < Compression::MIN_SIZE
+        || contentType == this->mHeaders.end()
+        || !MimeType::isCompressible(contentType->second)
+    )
+        return Compression::Identity;
+
+    return this->negotiateEncoding(Compression::COMPRESSORS);
+};
+
+Compression::Encoding HttpResponse::negotiateEncoding(const std::span<const Compression::Encoding> available)
+{
+    if (
+        available.empty()
+        || (this->mStatusCode >= 100 && this->mStatusCode < 200)
+        || HttpStatus::NoContent == this->mStatusCode
+        || HttpStatus::NotModified == this->mStatusCode
+        || this->mHeaders.contains("Content-Encoding")
+        || this->mHeaders.contains("Content-Range")
+    )
+        return Compression::Identity;
+
+    if (std::string& vary = this->mHeaders["Vary"];
+        vary.empty())
+        vary = "Accept-Encoding";
+    else if (vary.find("Accept-Encoding") == std::string::npos && vary != "*")
+        vary += ", Accept-Encoding";
+
+    return Compression::negotiate(this->mAcceptedEncodings, available);
 };
 
 bool HttpResponse::sendStatus(const HttpStatus::Code status)
@@ -41,21 +237,113 @@ bool HttpResponse::sendStatus(const HttpStatus::Code status)
     return this->send("");
 };
 
-bool HttpResponse::sendFile(const std::filesystem::path& path)
+bool HttpResponse::sendFile(const std::filesystem::path& path, const std::string& contentType)
 {
-    std::ifstream file(path, std::ios::binary);
+    // Validators of the file's version, so an unchanged file is answered before any of it is read
+    const auto& setValidators = [this](const size_t size, const std::time_t modified, const long nanoseconds) {
+        if (!this->mHeaders.contains("ETag"))
+            this->setHeader("ETag", ETag::fromMetadata(size, modified, nanoseconds));
+
+        if (!this->mHeaders.contains("Last-Modified"))
+            this->setHeader("Last-Modified", HttpDate::toString(modified));
+    };
+
+#if defined(__unix__) || defined(__APPLE__)
+    const int descriptor = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    struct stat info{};
+    if (descriptor >= 0 && fstat(descriptor, &info) == 0 && S_ISREG(info.st_mode))
+    {
+        auto file = std::make_shared<FileHandle>(descriptor);
+        const auto size = static_cast<size_t>(info.st_size);
+#if defined(__APPLE__)
+        setValidators(size, info.st_mtime, info.st_mtimespec.tv_nsec);
+#else
+        setValidators(size, info.st_mtime, info.st_mtim.tv_nsec);
+#endif
+
+        this->setHeader("Content-Type", contentType.empty() ? MimeType::getMimeType(path) : contentType);
+
+        if (this->sendNotModified())
+            return true;
+
+        // Queue the file itself so whoever drains the output sends it without buffering it here.
+        // It goes out uncompressed, reading and compressing it on every request costs more than
+        // the bytes it saves (StaticFileCache keeps compressed copies of the files it caches)
+        if (this->mOutputBuffer != nullptr && this->mOutputBuffer->acceptsFiles())
+            return this->sendBody(file, size);
+    }
+    else if (descriptor >= 0)
+        ::close(descriptor);
+#else
+    std::error_code error;
+    const auto size = std::filesystem::file_size(path, error);
+    const auto& modified = std::filesystem::last_write_time(path, error);
+    if (!error)
+    {
+        const auto& time = std::chrono::clock_cast<std::chrono::system_clock>(modified);
+        setValidators(static_cast<size_t>(size), std::chrono::system_clock::to_time_t(time),
+            static_cast<long>(modified.time_since_epoch().count() % 1000000000));
+
+        if (this->sendNotModified())
+            return true;
+    };
+#endif
+
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
     if (!file)
     {
         this->setStatus(HttpStatus::InternalServerError);
         this->setHeader("Content-Type", "text/plain");
+        this->removeHeader("Content-Encoding");
+        this->removeHeader("ETag");
+        this->removeHeader("Last-Modified");
         return this->send("Server Error");
     };
 
-    std::ostringstream buffer;
-    buffer << file.rdbuf();
+    // Read straight into a string of the file's size
+    std::string buffer(static_cast<size_t>(file.tellg()), '\0');
+    file.seekg(0);
+    file.read(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+    buffer.resize(static_cast<size_t>(file.gcount()));
+
+    this->setHeader("Content-Type", contentType.empty() ? MimeType::getMimeType(path) : contentType);
 
-    this->setHeader("Content-Type", MimeType::getMimeType(path));
-    return this->send(buffer.str());
+    // Sent in parts when they're asked for, compressed as a whole otherwise
+    if (!this->mRange.empty())
+        return this->send(std::make_shared<const std::string>(std::move(buffer)));
+
+    return this->send(std::move(buffer));
+};
+
+bool HttpResponse::sendNotModified()
+{
+    if (HttpStatus::OK != this->mStatusCode || true == this->mHeadersSent)
+        return false;
+
+    bool notModified = false;
+    if (!this->mIfNoneMatch.empty())
+    {
+        const auto& etag = this->mHeaders.find("ETag");
+        notModified = etag != this->mHeaders.end() && ETag::matches(this->mIfNoneMatch, etag->second);
+    }
+    else if (!this->mIfModifiedSince.empty())
+    {
+        // Only ever compared in whole seconds, that's all either date has
+        const auto& lastModified = this->mHeaders.find("Last-Modified");
+        const auto& since = HttpDate::fromString(this->mIfModifiedSince);
+        const auto& modified = lastModified != this->mHeaders.end()
+            ? HttpDate::fromString(lastModified->second) : std::nullopt;
+
+        notModified = since.has_value() && modified.has_value() && modified.value() <= since.value();
+    };
+
+    if (!notModified)
+        return false;
+
+    this->mStatusCode = HttpStatus::NotModified;
+    this->removeHeader("Content-Encoding");
+    this->removeHeader("Content-Range");
+    return this->send();
 };
 
 bool HttpResponse::redirect(const std::string& location)
@@ -64,23 +352,38 @@ bool HttpResponse::redirect(const std::string& location)
         this->mStatusCode = HttpStatus::Found;
 
     this->setHeader("Location", location);
+    this->setHeader("Content-Length", "0");
 
-    const std::ostringstream& stream = this->toHttpString();
-    return this->sendToSocket(stream.str());
+    return this->sendToSocket(this->toHttpString());
 }
 
-std::ostringstream HttpResponse::toHttpString()
+std::string HttpResponse::toHttpString()
 {
+    const std::string& version = HttpVersion::toString(this->mVersion);
+    const std::string& status = std::to_string(this->mStatusCode);
     const std::string& statusMessage = HttpStatus::toString(this->mStatusCode);
 
-    std::ostringstream stream;
-    stream
-        << HttpVersion::toString(this->mVersion) << " " << std::to_string(this->mStatusCode)
-        << " " << statusMessage << "\r\n";
+    // Sized up front so the header block is built with a single allocation
+    size_t size = version.size() + status.size() + statusMessage.size() + 4 + 2;
+    for (const auto& [key, value] : this->mHeaders)
+        size += key.size() + value.size() + 4;
+
+    const bool closes = this->mShouldClose && !this->mHeaders.contains("Connection");
+    if (closes)
+        size += 19;
+
+    std::string head;
+    head.reserve(size);
+    head.append(version).append(" ").append(status).append(" ").append(statusMessage).append("\r\n");
 
     for (const auto& [key, value] : this->mHeaders)
-        stream << key << ": " << value << "\r\n";
-    return stream;
+        head.append(key).append(": ").append(value).append("\r\n");
+
+    if (closes)
+        head.append("Connection: close\r\n");
+
+    head.append("\r\n");
+    return head;
 };
 
 void HttpResponse::setHeaders(const std::unordered_map<std::string, std::string>& headers)
@@ -89,24 +392,34 @@ void HttpResponse::setHeaders(const std::unordered_map<std::string, std::string>
         this->setHeader(key, value);
 };
 
-bool HttpResponse::sendToSocket(const std::string& data)
+bool HttpResponse::sendToSocket(std::string head, std::string body)
 {
     if (true == this->mHeadersSent)
         return false;
 
-    HttpServer::sendToSocket(this->mClientSocket, data);
+    if (this->mOutputBuffer != nullptr)
+    {
+        this->mOutputBuffer->append(std::move(head));
+        this->mOutputBuffer->append(std::move(body));
+    }
+    else
+    {
+        OutputQueue output;
+        output.append(std::move(head));
+        output.append(std::move(body));
+        output.writeTo(this->mClientSocket);
+    };
 
     this->mHeadersSent = true;
-    if (this->mShouldClose)
-        this->closeSocket();
     return true;
 };
 
-void HttpResponse::closeSocket() const
+bool HttpResponse::shouldClose() const
 {
-#if defined(_WIN32)
-    ::closesocket(this->mClientSocket);
-#elif defined(__unix__) || defined(__APPLE__)
-    ::close(this->mClientSocket);
-#endif
+    if (this->mShouldClose)
+        return true;
+
+    const auto& connection = this->mHeaders.find("Connection");
+    return connection != this->mHeaders.end()
+        && (connection->second == "close" || connection->second == "Close");
 };
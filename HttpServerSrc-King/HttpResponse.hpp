@@ -2,11 +2,16 @@
 #define HTTPRESPONSE_HPP
 
 #include "HttpRequest.hpp"
+#include "OutputQueue.hpp"
+#include "util/ByteRange.hpp"
+#include "util/Compression.hpp"
 #include "util/HttpStatus.hpp"
 #include "util/MimeType.hpp"
 
 class HttpResponse
 {
+    friend class HttpServer;
+
 private:
     bool mHeadersSent{ false };
     HttpStatus::Code mStatusCode{ HttpStatus::OK };
@@ -14,7 +19,16 @@ private:
 
 protected:
     Socket_t mClientSocket{};
-    HttpRequest mRequest;
+    OutputQueue* mOutputBuffer{ nullptr }; // Set when responses are batched per connection
+    // The only part of the request a response needs, so it never copies the request itself
+    HttpMethod::Method mRequestMethod{ HttpMethod::GET };
+    Compression::Qualities mAcceptedEncodings{};
+    // Range and If-Range of a GET, empty otherwise
+    std::string mRange{};
+    std::string mIfRange{};
+    // If-None-Match and If-Modified-Since of a GET or HEAD, empty otherwise
+    std::string mIfNoneMatch{};
+    std::string mIfModifiedSince{};
     bool mShouldClose{ true };
     HttpVersion::Version mVersion{ HttpVersion::HTTP_1_1 };
 
@@ -25,7 +39,12 @@ public:
         const HttpVersion::Version version = HttpVersion::HTTP_1_1,
         const bool shouldClose = true) :
             mClientSocket(clientSocket),
-            mRequest(req),
+            mRequestMethod(req.getMethod()),
+            mAcceptedEncodings(Compression::parse(req.getHeader(HeaderName::AcceptEncoding).value_or(""))),
+            mRange(req.getMethod() == HttpMethod::GET ? req.getHeader(HeaderName::Range).value_or("") : ""),
+            mIfRange(req.getMethod() == HttpMethod::GET ? req.getHeader(HeaderName::IfRange).value_or("") : ""),
+            mIfNoneMatch(isSafe(req.getMethod()) ? req.getHeader(HeaderName::IfNoneMatch).value_or("") : ""),
+            mIfModifiedSince(isSafe(req.getMethod()) ? req.getHeader(HeaderName::IfModifiedSince).value_or("") : ""),
             mShouldClose(shouldClose),
             mVersion(version) {};
 
@@ -36,12 +55,32 @@ public:
     HttpResponse& operator=(HttpResponse&&) noexcept = default;
 
     HttpResponse& setStatus(const HttpStatus::Code status) { this->mStatusCode = status; return *this; };
+    [[nodiscard]] HttpStatus::Code getStatus() const { return this->mStatusCode; };
 
+    // Compressed when the client accepts it and the Content-Type is worth compressing
     bool send(std::string data = "");
+    // Sends a buffer that's shared with others (e.g. cached) without copying it, and as is.
+    // Like sendFile, only the parts a Range header asks for when it has one
+    bool send(std::shared_ptr<const std::string> data);
     bool sendStatus(HttpStatus::Code status);
-    bool sendFile(const std::filesystem::path& path);
+    // Content-Type follows the extension unless one is given, ETag/Last-Modified the file's version unless they're
+    // set already. Answers 304 by itself when the client's copy is still current. Sent as it is with sendfile()
+    // where the output takes files, read and compressed like send() otherwise
+    bool sendFile(const std::filesystem::path& path, const std::string& contentType = "");
+    // Sends 304 Not Modified when If-None-Match (or If-Modified-Since without it) says the client's copy
+    // matches the ETag/Last-Modified set on this response. False when the body is to be sent
+    bool sendNotModified();
     bool redirect(const std::string& location);
 
+    // How a body of this length is best compressed for the client, Identity to send it as is.
+    // Adds Vary: Accept-Encoding whenever the answer depends on the client
+    Compression::Encoding negotiateEncoding(size_t length);
+    // The same for a body that's available in these encodings only (e.g. precompressed files)
+    Compression::Encoding negotiateEncoding(std::span<const Compression::Encoding> available);
+
+    [[nodiscard]] bool isSent() const { return this->mHeadersSent; };
+    [[nodiscard]] bool shouldClose() const;
+
     [[nodiscard]] const std::string& getHeader(const std::string& key) { return this->mHeaders[key]; };
     void setHeader(const std::string& key, const std::string& value) { this->mHeaders[key] = value; };
     bool removeHeader(const std::string& key) { return this->mHeaders.erase(key) != 0; };
@@ -50,9 +89,18 @@ public:
     [[nodiscard]] const HeadersMap_t& getHeaders() const { return this->mHeaders; };
 
 private:
-    std::ostringstream toHttpString();
-    bool sendToSocket(const std::string& data);
-    void closeSocket() const;
+    static bool isSafe(const HttpMethod::Method method) { return method == HttpMethod::GET || method == HttpMethod::HEAD; };
+
+    // Status line and headers, up to and including the blank line
+    std::string toHttpString();
+    // Sets Content-Length, false when the status or method means no body is sent
+    bool prepareBody(size_t length);
+    bool sendToSocket(std::string head, std::string body = {});
+    // The whole body (a file or a shared buffer) or the ranges of it that were asked for, as 206 or 416
+    template<typename Body>
+    bool sendBody(const Body& body, size_t size);
+    // Nothing to send the whole body, empty when no range can be satisfied. Also advertises Accept-Ranges
+    std::optional<std::vector<ByteRange::Range>> selectRanges(size_t size);
 };
 
 #endif // !HTTPRESPONSE_HPP
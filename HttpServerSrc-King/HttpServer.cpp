@@ -1,3 +1,5 @@
+#include <algorithm>
+#include <csignal>
 #include <print>
 
 #include <openssl/sha.h>
@@ -5,6 +7,29 @@
 
 #include "HttpServer.hpp"
 
+// Whether a comma separated header value (Connection, Upgrade) lists the token, case-insensitive
+inline bool hasToken(std::string_view value, const std::string_view token)
+{
+    while (!value.empty()) {
+        const size_t comma = value.find(',');
+        std::string_view item = value.substr(0, comma);
+        value = comma == std::string_view::npos ? std::string_view{} : value.substr(comma + 1);
+
+        while (!item.empty() && (item.front() == ' ' || item.front() == '\t'))
+            item.remove_prefix(1);
+
+        while (!item.empty() && (item.back() == ' ' || item.back() == '\t'))
+            item.remove_suffix(1);
+
+        if (std::ranges::equal(item, token, [](const unsigned char x, const unsigned char y) {
+                return std::tolower(x) == std::tolower(y);
+            }))
+            return true;
+    };
+
+    return false;
+};
+
 unsigned int HttpServer::sMaxWorkerThreads = std::max(1u, std::thread::hardware_concurrency());
 HttpServer::HttpServer(const bool enableWebSockets, const HttpVersion::Version version)
 {
@@ -58,6 +83,14 @@ void HttpServer::close()
         return;
     
     this->b_mIsRunning = false;
+
+#if defined(__linux__)
+    for (const auto& eventLoop : this->mEventLoops)
+        eventLoop->stop();
+
+    for (const auto& ioUringLoop : this->mIoUringLoops)
+        ioUringLoop->stop();
+#endif
     
     // Notify all waiting threads to wake up and exit
     mQueueCondVar.notify_all();
@@ -69,6 +102,13 @@ void HttpServer::close()
         
         thread.join();
     };
+
+#if defined(__linux__)
+    for (const Socket_t socket : this->mReusePortSockets)
+        ::close(socket);
+
+    this->mReusePortSockets.clear();
+#endif
     
     if (this->mServerSocket == -1)
         return;
@@ -84,51 +124,156 @@ void HttpServer::close()
 };
 
 void HttpServer::listen()
+{
+    // Routes are in by now, the regex ones are compiled into one automaton here rather than per use()
+    this->mRouter.compile();
+    if (!this->mRouter.isCompiled())
+        std::println("Too many regex routes for one automaton, they're matched by NFA simulation (slower per route)");
+
+    this->bindSocket(this->mServerSocket);
+    this->b_mIsRunning = true;
+
+#if defined(__unix__) || defined(__APPLE__)
+    // A client that resets the connection mid-response fails the write with EPIPE instead
+    // of killing the process, sendfile() and write() have no MSG_NOSIGNAL
+    std::signal(SIGPIPE, SIG_IGN);
+#endif
+
+#if defined(__linux__)
+    // Only the epoll loop reads WebSocket frames, so those servers stay on it
+    if (this->b_mUseIoUring && !this->b_mEnableWebSockets && IoUring::isSupported())
+    {
+        this->listenIoUring();
+        return;
+    };
+
+    if (this->b_mReusePort)
+    {
+        this->listenReusePort();
+        return;
+    };
+#endif
+    
+    mWorkerThreads.resize(sMaxWorkerThreads);
+    for (unsigned int i = 0; i < sMaxWorkerThreads; i++) {
+        mWorkerThreads[i] = std::thread(&HttpServer::processRequests, this, i);
+    };
+
+#if defined(__linux__)
+    this->mEventLoops.push_back(std::make_unique<EventLoop>(this->mServerSocket,
+        [this](std::shared_ptr<Connection> connection) {
+            {
+                std::unique_lock lock(mQueueMutex);
+                mRequestQueue.push(std::move(connection));
+            };
+            mQueueCondVar.notify_one(); // Wake up one waiting worker
+        }, this->mKeepAliveTimeout, this->mRequestLimits));
+
+    this->mEventLoops.front()->run();
+#else
+    this->receiveConnections();
+#endif
+};
+
+void HttpServer::bindSocket(const Socket_t socket) const
 {
     constexpr int opt = 1;
     // SO_REUSEADDR
 #if defined(_WIN32)
-    if (setsockopt(this->mServerSocket, SOL_SOCKET, SO_REUSEADDR,
+    if (setsockopt(socket, SOL_SOCKET, SO_REUSEADDR,
                    reinterpret_cast<const char*>(&opt), sizeof(opt)) < 0)
 #elif defined(__unix__) || defined(__APPLE__)
-    if (setsockopt(this->mServerSocket, SOL_SOCKET, SO_REUSEADDR,
+    if (setsockopt(socket, SOL_SOCKET, SO_REUSEADDR,
                    &opt, sizeof(opt)) < 0)
 #endif
     {
         throw std::runtime_error("Failed to set SO_REUSEADDR");
     };
 
+#if defined(__linux__)
+    // SO_REUSEPORT
+    if (this->b_mReusePort && setsockopt(socket, SOL_SOCKET, SO_REUSEPORT,
+                   &opt, sizeof(opt)) < 0)
+    {
+        throw std::runtime_error("Failed to set SO_REUSEPORT");
+    };
+#endif
+
     // TCP_NODELAY
 #if defined(_WIN32)
-    if (setsockopt(this->mServerSocket, IPPROTO_TCP, TCP_NODELAY,
+    if (setsockopt(socket, IPPROTO_TCP, TCP_NODELAY,
                    reinterpret_cast<const char*>(&opt), sizeof(opt)) < 0)
 #elif defined(__unix__) || defined(__APPLE__)
-    if (setsockopt(this->mServerSocket, IPPROTO_TCP, TCP_NODELAY,
+    if (setsockopt(socket, IPPROTO_TCP, TCP_NODELAY,
                    &opt, sizeof(opt)) < 0)
 #endif
     {
         throw std::runtime_error("Failed to set TCP_NODELAY");
     };
 
-    if (bind(this->mServerSocket, reinterpret_cast<sockaddr *>(&mSocketAddress), sizeof(mSocketAddress)) < 0)
+    if (bind(socket, reinterpret_cast<const sockaddr *>(&mSocketAddress), sizeof(mSocketAddress)) < 0)
     {
         throw std::runtime_error("Failed to bind to socket");
     };
 
-    if (::listen(this->mServerSocket, sMaxConnections) < 0)
+    if (::listen(socket, sMaxConnections) < 0)
     {
         throw std::runtime_error("Failed to listen");
     };
+};
 
-    this->b_mIsRunning = true;
-    
-    mWorkerThreads.resize(sMaxWorkerThreads);
-    for (auto i = 0; i < sMaxWorkerThreads; i++) {
-        mWorkerThreads[i] = std::thread(&HttpServer::processRequests, this, i);
+#if defined(__linux__)
+Socket_t HttpServer::getWorkerSocket(const unsigned int workerId)
+{
+    if (workerId == 0 || !this->b_mReusePort)
+        return this->mServerSocket;
+
+    const Socket_t socket = ::socket(AF_INET, SOCK_STREAM, 0);
+    if (socket < 0) {
+        throw std::runtime_error("Failed to create socket");
     };
 
-    this->receiveConnections();
+    this->mReusePortSockets.push_back(socket);
+    this->bindSocket(socket);
+    return socket;
+};
+
+void HttpServer::listenReusePort()
+{
+    // Every worker gets its own listening socket and event loop, the kernel
+    // spreads new connections across them and each worker serves its own
+    for (unsigned int i = 0; i < sMaxWorkerThreads; ++i)
+    {
+        this->mEventLoops.push_back(std::make_unique<EventLoop>(this->getWorkerSocket(i),
+            [this](const std::shared_ptr<Connection>& connection) {
+                this->serveConnection(*connection);
+            }, this->mKeepAliveTimeout, this->mRequestLimits));
+    };
+
+    for (size_t i = 1; i < this->mEventLoops.size(); ++i)
+        mWorkerThreads.emplace_back(&EventLoop::run, this->mEventLoops[i].get());
+
+    this->mEventLoops.front()->run();
+};
+
+void HttpServer::listenIoUring()
+{
+    // One ring per worker, all accepting on the shared listening socket
+    // unless SO_REUSEPORT gives each its own
+    for (unsigned int i = 0; i < sMaxWorkerThreads; ++i)
+    {
+        this->mIoUringLoops.push_back(std::make_unique<IoUringLoop>(this->getWorkerSocket(i),
+            [this](const std::shared_ptr<Connection>& connection) {
+                this->serveConnection(*connection);
+            }, this->mKeepAliveTimeout, this->mRequestLimits));
+    };
+
+    for (size_t i = 1; i < this->mIoUringLoops.size(); ++i)
+        mWorkerThreads.emplace_back(&IoUringLoop::run, this->mIoUringLoops[i].get());
+
+    this->mIoUringLoops.front()->run();
 };
+#endif
 
 void HttpServer::receiveConnections()
 {
@@ -141,40 +286,28 @@ void HttpServer::receiveConnections()
         if (clientSocket < 0)
             continue;
 
+        // Idle keep-alive connections time out on their next blocking read
+#if defined(_WIN32)
+        const DWORD timeout = static_cast<DWORD>(std::chrono::milliseconds(this->mKeepAliveTimeout).count());
+        setsockopt(clientSocket, SOL_SOCKET, SO_RCVTIMEO, reinterpret_cast<const char*>(&timeout), sizeof(timeout));
+#elif defined(__unix__) || defined(__APPLE__)
+        const timeval timeout{ static_cast<time_t>(this->mKeepAliveTimeout.count()), 0 };
+        setsockopt(clientSocket, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+#endif
+
         {
             std::unique_lock lock(mQueueMutex);
-            mRequestQueue.emplace(clientSocket, clientAddress);
+            mRequestQueue.push(std::make_shared<Connection>(clientSocket, this->mRequestLimits));
         };
         mQueueCondVar.notify_one(); // Wake up one waiting worker
     };
 };
 
-template <typename Map, typename Handler>
- std::optional<std::pair<std::string, Handler>> findRoute(const std::string& path, Map routes) {
-    for (const auto& route : routes | std::views::keys)
-    {
-        bool matches = false;
-        try {
-            const std::regex pattern{ route };
-            matches = std::regex_match(path, pattern);
-        }
-        catch (...) {
-            matches = (route == path);
-        };
-
-        if (true == matches)
-            return std::make_pair(path, routes.at(route));
-    };
-
-    return std::nullopt;
-};
-
 void HttpServer::processRequests(int workerId)
 {
     while (this->b_mIsRunning)
     {
-        //sockaddr_in clientAddress{};
-        Socket_t clientSocket;
+        std::shared_ptr<Connection> connection;
         {
             std::unique_lock lock(mQueueMutex);
             mQueueCondVar.wait(lock, [this] {
@@ -184,68 +317,160 @@ void HttpServer::processRequests(int workerId)
             if (!b_mIsRunning && mRequestQueue.empty())
                 break;
 
-            const auto& [ socket, address ] = mRequestQueue.front();
-            clientSocket = socket;
-            //clientAddress = address;
+            connection = std::move(mRequestQueue.front());
             mRequestQueue.pop();
         };
 
-        std::vector<uint8_t> buffer(sMaxBufferSize);
-    #if defined(_WIN32)
-        const int bytesReceived = recv(clientSocket, reinterpret_cast<char *>(buffer.data()), static_cast<int>(buffer.size()), 0);
-    #elif defined(__unix__) || defined(__APPLE__)
-        const ssize_t bytesReceived = read(clientSocket, buffer.data(), buffer.size());
-    #endif
+        this->serveConnection(*connection);
+    };
+};
 
-        if (bytesReceived < 1)
-            return;
+void HttpServer::serveConnection(Connection& connection)
+{
+    bool keepAlive = false;
+    try {
+        keepAlive = this->handleConnection(connection);
+    }
+    catch (const std::exception&) {};
 
-        std::string data(reinterpret_cast<const char*>(buffer.data()), bytesReceived);
-        HttpRequest request{ clientSocket, data };
+    if (keepAlive)
+        this->resumeConnection(connection);
+    else this->releaseConnection(connection);
+};
 
-        const std::string& path = request.getPath();
-        const HttpMethod::Method& method = request.getMethod();
+bool HttpServer::handleConnection(Connection& connection)
+{
+    if (connection.mWebSocket != nullptr)
+        return this->handleWebSocket(connection);
 
-        if (HttpServer::isUpgradeRequest(request))
+    // Serve every request that is already buffered (pipelined requests arrive
+    // in the same read), their responses are collected in order and written together
+    bool keepAlive = true;
+    while (keepAlive)
+    {
+        const RequestReader::Status status = connection.readRequest();
+        if (status == RequestReader::Status::Incomplete)
         {
-            if (this->b_mEnableWebSockets)
-                this->upgradeConnection(clientSocket, request, buffer);
-
-        #if defined(_WIN32)
-            ::closesocket(clientSocket);
-        #elif defined(__unix__) || defined(__APPLE__)
-            ::close(clientSocket);
-        #endif
-            return;
-        };
-
-        const auto& route =
-            findRoute<decltype(this->mRoutes), RouteHandlers>(path, this->mRoutes);
+#if defined(__linux__)
+            // The event loop reads the rest once the connection is rearmed
+            break;
+#else
+            connection.compact();
+            if (!connection.flush() || connection.receive() < 1)
+                return false;
 
-        if (!route.has_value())
             continue;
+#endif
+        };
 
-        const auto& handlers = route.value().second;
-        if (!handlers.contains(method))
-            continue;
+        if (status != RequestReader::Status::Complete)
+        {
+            const HttpStatus::Code code = RequestReader::toHttpStatus(status);
+            connection.mOutput.append(std::string{ HttpVersion::toString(this->mVersion) }
+                .append(" ").append(std::to_string(code)).append(" ")
+                .append(HttpStatus::toString(code))
+                .append("\r\nContent-Length: 0\r\nConnection: close\r\n\r\n"));
+
+            keepAlive = false;
+            break;
+        };
 
-        HttpResponse response{ clientSocket, request, this->mVersion };
-        response.setHeader("Content-Type", "text/plain");
+        keepAlive = this->handleRequest(connection, connection.getRequest());
+        connection.nextRequest();
 
-        const std::vector<Middleware>& chain = handlers.at(method);
+        if (connection.mWebSocket != nullptr)
         {
-            size_t i = 0;
-            std::function<void()> next = [&]() {
-                if (i >= chain.size())
-                    return;
+            // Anything that followed the upgrade request already went to the session
+            connection.mBuffer = std::string{};
+            return keepAlive && this->handleWebSocket(connection);
+        };
 
-                auto& mw = chain[i++];
-                mw(request, response, next);
-            };
+        if (connection.mOutput.size() >= sMaxBufferSize)
+        {
+            if (!connection.flush())
+                return false;
 
-            next();
+            // The event loop writes the rest once the socket takes data again, the requests behind wait until then
+            if (connection.isWritePending())
+                break;
         };
     };
+
+    connection.compact();
+    return connection.flush() && keepAlive;
+};
+
+bool HttpServer::handleRequest(Connection& connection, const std::string_view data)
+{
+    const Socket_t clientSocket = connection.getSocket();
+    // Borrows the connection buffer, which stays put until the request has been handled
+    HttpRequest request{ clientSocket, data };
+
+    const std::string_view path = request.getPath();
+    const HttpMethod::Method& method = request.getMethod();
+
+    if (HttpServer::isUpgradeRequest(request))
+    {
+        if (!this->b_mEnableWebSockets)
+            return false;
+
+        // Earlier responses go out ahead of the handshake, if the socket can't take them
+        // right away they're still written but the connection isn't upgraded
+        if (!connection.flush() || connection.isWritePending())
+            return false;
+
+        return this->upgradeConnection(connection, request);
+    };
+
+    bool keepAlive = ++connection.mRequestCount != this->mMaxKeepAliveRequests;
+    if (const auto& header = request.getHeader(HeaderName::Connection);
+        header.has_value() && hasToken(header.value(), "close"))
+        keepAlive = false;
+
+    HttpResponse response{ clientSocket, request, this->mVersion, !keepAlive };
+    response.mOutputBuffer = &connection.mOutput;
+    response.setHeader("Content-Type", "text/plain");
+
+    const auto& route = this->mRouter.find(path);
+    if (!route.has_value())
+    {
+        response.setStatus(HttpStatus::NotFound);
+        response.send("Not Found");
+        return keepAlive;
+    };
+
+    const Middleware& chain = this->mRoutes[route.value()][method];
+    if (!chain)
+    {
+        response.setStatus(HttpStatus::MethodNotAllowed);
+        response.send("Method Not Allowed");
+        return keepAlive;
+    };
+
+    chain(request, response, NextFn{});
+
+    // A connection whose handler never answered can't be reused
+    return keepAlive && response.isSent() && !response.shouldClose();
+};
+
+void HttpServer::resumeConnection(Connection& connection)
+{
+#if defined(__linux__)
+    if (connection.mEventLoop != nullptr)
+        connection.mEventLoop->rearm(connection);
+    else if (connection.mIoUringLoop != nullptr)
+        connection.mIoUringLoop->rearm(connection);
+#endif
+};
+
+void HttpServer::releaseConnection(Connection& connection)
+{
+#if defined(__linux__)
+    if (connection.mEventLoop != nullptr)
+        connection.mEventLoop->release(connection);
+    else if (connection.mIoUringLoop != nullptr)
+        connection.mIoUringLoop->release(connection);
+#endif
 };
 
 
@@ -270,10 +495,20 @@ inline std::string extractPrefix(const std::string& regexPath)
     return regexPath.substr(0, i);
 };
 
-Middleware HttpServer::useStatic(const std::string& directory)
+Middleware HttpServer::useStatic(const std::string& directory, const StaticCacheLimits& limits)
 {
-    return [directory](const HttpRequest& request, HttpResponse& response, const NextFn&) {
-        const std::string& fullPath = request.getPath();
+    std::error_code rootError;
+    const auto& cache = std::make_shared<StaticFileCache>(std::filesystem::weakly_canonical(directory, rootError), limits);
+
+    return [directory, cache](const HttpRequest& request, HttpResponse& response, const NextFn&) {
+        const std::string_view fullPath = request.getPath();
+        const std::string key{ fullPath };
+
+        if (const auto& file = cache->find(key))
+        {
+            cache->serve(response, key, file);
+            return;
+        };
         const std::string& originalPattern = request.getOriginalPath();
 
         const std::string& routePrefix = extractPrefix(originalPattern);
@@ -284,7 +519,7 @@ Middleware HttpServer::useStatic(const std::string& directory)
             return;
         };
 
-        std::string relative = fullPath.substr(routePrefix.length());
+        std::string relative{ fullPath.substr(routePrefix.length()) };
         if (!relative.empty() && relative.front() == '/')
             relative.erase(0, 1);
 
@@ -315,167 +550,137 @@ Middleware HttpServer::useStatic(const std::string& directory)
             return;
         };
 
+        if (const auto& file = cache->load(key, canonicalPath, requestedPath.lexically_normal()))
+        {
+            cache->serve(response, key, file);
+            return;
+        };
+
         response.sendFile(canonicalPath);
     };
 };
 
-void HttpServer::upgradeConnection(Socket_t socket, const HttpRequest& request, std::vector<uint8_t>& buffer) {
-    const std::string& path = request.getPath();
-    const auto& route =
-        findRoute<decltype(this->mSockets), WebSocketHandler>(path, this->mSockets);
+bool HttpServer::upgradeConnection(Connection& connection, const HttpRequest& request) {
+    const std::string_view path = request.getPath();
+    const auto& route = this->mSocketRouter.find(path);
 
     if (!route.has_value())
-        return;
+        return false;
 
-    const auto& key = request.getHeader("Sec-WebSocket-Key");
+    const auto& key = request.getHeader(HeaderName::SecWebSocketKey);
     if (request.getMethod() != HttpMethod::GET || !key.has_value())
-    {
-#if defined(_WIN32)
-        ::closesocket(socket);
-#elif defined(__unix__) || defined(__APPLE__)
-        ::close(socket);
-#endif
-        return;
-    };
+        return false;
 
+    const Socket_t socket = connection.getSocket();
     HttpResponse response{ socket, request, this->mVersion, false };
-    HttpServer::upgradeWebSocket(response, key.value());
+    response.mOutputBuffer = &connection.mOutput;
+    HttpServer::upgradeWebSocket(response, std::string{ key.value() });
 
-    const auto& handlers = route.value().second;
-    std::function next = [&]() {
+    const WebSocketHandler& handlers = this->mSockets[route.value()];
+    const auto& next = [&]() {
         response.send();
 
-        WebSocket webSocket{ socket, request };
-        handlers.onOpen(webSocket);
+        connection.mWebSocket = std::make_unique<WebSocketSession>(socket, request, handlers, this->mWebSocketLimits);
 
-        std::vector<uint8_t> fragmentBuffer;
-        uint8_t fragmentOpcode = 0;
-        bool isFragmented = false;
-        while (true)
-        {
-    #if defined(_WIN32)
-            const int received = recv(socket, reinterpret_cast<char *>(buffer.data()), static_cast<int>(buffer.size()), 0);
-    #elif defined(__unix__) || defined(__APPLE__)
-            const ssize_t received = read(socket, buffer.data(), buffer.size());
-    #endif
+        // The handshake goes out through the outbox, ahead of anything onOpen sends
+        std::string handshake;
+        for (const auto& segment : connection.mOutput.take())
+            handshake.append(segment.bytes());
 
-            if (received <= 0)
-                break;
+        connection.mWebSocket->socket.mOutbox->push(std::make_shared<const std::string>(std::move(handshake)));
 
-            const uint8_t opcode = buffer[0] & 0x0F;
-            if (opcode == 0x8) {
-                handlers.onClose(webSocket);
-                HttpServer::sendToSocket(socket, std::string{ static_cast<char>(0x88), 0x00 });
-                break;
-            };
+        // Frames the client sent right behind the upgrade request
+        const std::string& buffer = connection.getBuffer();
+        const size_t end = connection.mReader.getEnd();
+        connection.mWebSocket->reader.append(std::span{
+            reinterpret_cast<const uint8_t*>(buffer.data()) + end, buffer.size() - end });
+
+        handlers.onOpen(connection.mWebSocket->socket);
+    };
 
-            const bool isFinal = buffer[0] & 0x80;
-            const uint8_t lengthCode = buffer[1] & 0x7F;
+    std::visit([&]<typename T0>(T0&& fn) {
+        using FnType = std::decay_t<T0>;
+        if constexpr (std::is_same_v<FnType, Middleware>) {
+            fn(request, response, NextFn{ next });
+        }
+        else {
+            fn(request, response);
+            next();
+        };
+    }, handlers.onRequest);
 
-            size_t payloadSize = lengthCode;
-            size_t offset = 2;
-            if (lengthCode == 126) {
-                if (received < 4)
-                    continue;
+    return connection.mWebSocket != nullptr;
+};
 
-                payloadSize = (static_cast<size_t>(buffer[2]) << 8) | buffer[3];
-                offset += 2;
-            }
-            else if (lengthCode == 127) {
-                if (received < 10)
-                    continue;
+bool HttpServer::handleWebSocket(Connection& connection)
+{
+    WebSocketSession& session = *connection.mWebSocket;
+    const WebSocketHandler& handlers = *session.handler;
+    WebSocket& webSocket = session.socket;
 
-                payloadSize = 0;
-                for (int i = 0; i < 8; ++i)
-                    payloadSize = (payloadSize << 8) | static_cast<size_t>(buffer[2 + i]);
+    // The event loop may have framed a message already
+    WebSocketReader::Status status = session.reader.getStatus();
+    if (status == WebSocketReader::Status::Incomplete)
+        status = connection.readMessage();
 
-                offset += 8;
+    while (true)
+    {
+        if (status == WebSocketReader::Status::Incomplete)
+        {
+#if defined(__linux__)
+            // The event loop reads the rest once the connection is rearmed
+            if (!session.isClosed)
+                return true;
+#else
+            if (connection.receive() > 0)
+            {
+                status = connection.readMessage();
+                continue;
             };
+#endif
+            handlers.onClose(webSocket);
+            return false;
+        };
 
-            if (buffer.size() < offset + 4 + payloadSize)
-                continue; // Wait for more data
+        if (status != WebSocketReader::Status::Complete)
+        {
+            const uint16_t code = WebSocketReader::toCloseCode(status);
+            const std::array<uint8_t, 2> reason{ static_cast<uint8_t>(code >> 8), static_cast<uint8_t>(code & 0xFF) };
+            handlers.onClose(webSocket);
+            webSocket.sendFrame(0x8, reason);
+            return false;
+        };
 
-            std::array<uint8_t, 4> maskingKey{};
-            std::copy_n(buffer.data() + offset, 4, maskingKey.begin());
-            offset += 4;
+        // Whole messages, straight out of the reader's buffer
+        const uint8_t opcode = session.reader.getOpcode();
+        const std::span<const uint8_t> payload = session.reader.getPayload();
+        if (opcode == 0x8) {
+            handlers.onClose(webSocket);
+            webSocket.sendFrame(0x8, {});
+            return false;
+        };
 
-            // Decode payload
-            std::vector<uint8_t> payload;
-            payload.reserve(payloadSize);
+        switch (opcode)
+        {
+            case 0x1:
+                handlers.onText(webSocket, std::string_view{ reinterpret_cast<const char*>(payload.data()), payload.size() });
+                break;
 
-            for (size_t i = 0; i < payloadSize; ++i)
-                payload.push_back(static_cast<char>(buffer[offset + i] ^ maskingKey[i % 4]));
+            case 0x2:
+                handlers.onBinary(webSocket, payload);
+                break;
 
-            switch (opcode)
-            {
-                case 0x1: {
-                    // Text frame - possibly fragmented
-                    if (!isFinal)
-                    {
-                        fragmentBuffer = payload;
-                        fragmentOpcode = opcode;
-                        isFragmented = true;
-                        continue;
-                    };
-
-                    const std::string text{payload.begin(), payload.end()};
-                    handlers.onText(webSocket, text);
-                    break;
-                };
-
-                case 0x2: {
-                    // Binary frame - possibly fragmented
-                    if (!isFinal)
-                    {
-                        fragmentBuffer = payload;
-                        fragmentOpcode = opcode;
-                        isFragmented = true;
-                        continue;
-                    };
-
-                    handlers.onBinary(webSocket, payload);
-                    break;
-                };
-
-                case 0x0: {
-                    // Continuation frame
-                    if (!isFragmented)
-                        continue; // Unexpected continuation
-
-                    fragmentBuffer.insert(fragmentBuffer.end(), payload.begin(), payload.end());
-                    if (!isFinal)
-                        continue;
-
-                    if (fragmentOpcode == 0x1) {
-                        const std::string text{fragmentBuffer.begin(), fragmentBuffer.end()};
-                        handlers.onText(webSocket, text);
-                    }
-                    else if (fragmentOpcode == 0x2) {
-                        handlers.onBinary(webSocket, fragmentBuffer);
-                    };
-
-                    fragmentBuffer.clear();
-                    isFragmented = false;
-                    break;
-                };
-
-                default:
-                    std::println("Unsupported opcode: {}", opcode);
-                    break;
-            };
-        };
-    };
+            case 0x9:
+                // Ping, answered with a pong carrying the same payload
+                webSocket.sendFrame(0xA, payload);
+                break;
 
-    std::visit([&]<typename T0>(T0&& fn) {
-        using FnType = std::decay_t<T0>;
-        if constexpr (std::is_same_v<FnType, Middleware>) {
-            fn(request, response, next);
-        }
-        else {
-            fn(request, response);
-            next();
+            default:
+                break;
         };
-    }, handlers.onRequest);
+
+        status = connection.readMessage();
+    };
 };
 
 void HttpServer::upgradeWebSocket(HttpResponse& response, const std::string& mainKey) {
@@ -498,25 +703,25 @@ void HttpServer::upgradeWebSocket(HttpResponse& response, const std::string& mai
 };
 
 bool HttpServer::isUpgradeRequest(const HttpRequest& request) {
-    if (const auto& connection = request.getHeader("Connection");
+    if (const auto& connection = request.getHeader(HeaderName::Connection);
         !connection.has_value()
-        || (connection.value() != "Upgrade" && connection.value() != "upgrade"))
+        || !hasToken(connection.value(), "upgrade"))
         return false;
 
-    if (const auto& upgrade = request.getHeader("Upgrade");
+    if (const auto& upgrade = request.getHeader(HeaderName::Upgrade);
         !upgrade.has_value()
-        || upgrade.value() != "websocket")
+        || !hasToken(upgrade.value(), "websocket"))
         return false;
 
-    if (const auto& key = request.getHeader("Sec-WebSocket-key");
+    if (const auto& key = request.getHeader(HeaderName::SecWebSocketKey);
         !key.has_value())
         return false;
 
     return true;
 };
 
-void HttpServer::sendToSocket(const Socket_t socket, const std::string& data) {
-    const char* buffer = data.c_str();
+bool HttpServer::sendToSocket(const Socket_t socket, const std::string_view data) {
+    const char* buffer = data.data();
     const size_t bytesToSend = data.size();
 
     size_t totalBytesSent = 0;
@@ -528,8 +733,16 @@ void HttpServer::sendToSocket(const Socket_t socket, const std::string& data) {
         const ssize_t bytesSent = ::write(socket, buffer + totalBytesSent, bytesToSend - totalBytesSent);
 #endif
         if (bytesSent < 0)
-            break;
+        {
+#if defined(__unix__) || defined(__APPLE__)
+            if (errno == EINTR)
+                continue;
+#endif
+            return false;
+        };
 
         totalBytesSent += bytesSent;
     };
+
+    return true;
 };
\ No newline at end of file
@@ -1,6 +1,8 @@
 #ifndef HTTPSERVER_HPP
 #define HTTPSERVER_HPP
 
+#include <array>
+#include <chrono>
 #include <thread>
 #include <vector>
 #include <functional>
@@ -8,6 +10,7 @@
 #include <mutex>
 #include <condition_variable>
 #include <regex>
+#include <string_view>
 #include <variant>
 #include <ranges>
 #include <unordered_map>
@@ -17,11 +20,21 @@
 
 #include "Common.hpp"
 
+#include "Connection.hpp"
+#include "EventLoop.hpp"
+#include "IoUringLoop.hpp"
 #include "HttpRequest.hpp"
+#include "MiddlewareChain.hpp"
 #include "HttpResponse.hpp"
+#include "RequestReader.hpp"
+#include "Router.hpp"
+#include "StaticFileCache.hpp"
 #include "WebSocket.hpp"
+#include "WebSocketHub.hpp"
+#include "WebSocketReader.hpp"
 
-using RouteHandlers = std::unordered_map<HttpMethod::Method, std::vector<Middleware>>;
+// One composed chain per method, empty when the route doesn't handle it
+using RouteHandlers = std::array<Middleware, HttpMethod::PATCH + 1>;
 class HttpServer
 {
 private:
@@ -31,18 +44,32 @@ private:
 
     bool b_mEnableWebSockets{ false };
     bool b_mIsRunning{ false };
+    bool b_mReusePort{ false };
+    bool b_mUseIoUring{ false };
+    size_t mMaxKeepAliveRequests{ 1000 };
+    std::chrono::seconds mKeepAliveTimeout{ 5 };
+    RequestLimits mRequestLimits{};
+    WebSocketLimits mWebSocketLimits{};
     std::vector<std::thread> mWorkerThreads{};
-    std::queue<std::pair<Socket_t, sockaddr_in>> mRequestQueue{};
+    std::queue<std::shared_ptr<Connection>> mRequestQueue{};
     std::mutex mQueueMutex{};
     std::condition_variable mQueueCondVar{};
+#if defined(__linux__)
+    std::vector<std::unique_ptr<EventLoop>> mEventLoops{};
+    std::vector<std::unique_ptr<IoUringLoop>> mIoUringLoops{};
+    std::vector<Socket_t> mReusePortSockets{};
+#endif
 
 protected:
     Socket_t mServerSocket{ 0 };
     sockaddr_in mSocketAddress{};
     HttpVersion::Version mVersion{ HttpVersion::HTTP_1_1 };
 
-    std::unordered_map<std::string, RouteHandlers> mRoutes{};
-    std::unordered_map<std::string, WebSocketHandler> mSockets{};
+    // Handlers by the index their route got in the router
+    Router mRouter{};
+    std::vector<RouteHandlers> mRoutes{};
+    Router mSocketRouter{};
+    std::vector<WebSocketHandler> mSockets{};
 
 public:
 	explicit HttpServer(bool enableWebSockets = false, HttpVersion::Version version = HttpVersion::HTTP_1_1);
@@ -54,48 +81,92 @@ public:
         for (int i = HttpMethod::GET; i <= static_cast<int>(HttpMethod::PATCH); ++i)
         {
             const auto& method = static_cast<HttpMethod::Method>(i);
-            this->use(route, method, std::move(mws...));
+            this->use(route, method, mws...);
         };
     };
 
+    // Only the first chain registered for a route and method is used
     template<typename... Middlewares>
         requires (is_middlware<Middlewares> && ...)
     void use(const std::string& route, HttpMethod::Method method, Middlewares... mws) {
-        std::vector<Middleware> middlewares;
-        (middlewares.push_back(
-            []<typename T>(T middleware) {
-                if constexpr (std::is_convertible_v<T, Middleware>)
-                    return middleware;
-
-                else return [middleware](const HttpRequest& req, HttpResponse& res, const NextFn& next) {
-                    middleware(req, res);
-                    next();
-                };
-            }(mws)
-        ), ...);
-
-        this->mRoutes[route].insert(
-            std::make_pair(method, std::move(middlewares))
-        );
+        const size_t index = this->mRouter.add(route);
+        if (index == this->mRoutes.size())
+            this->mRoutes.emplace_back();
+
+        Middleware& handler = this->mRoutes[index][method];
+        if (handler)
+            return;
+
+        if constexpr (sizeof...(Middlewares) == 1 && (std::is_same_v<Middlewares, Middleware> && ...))
+            handler = std::move(mws...);
+        else
+            handler = MiddlewareChain<Middlewares...>{ std::move(mws)... };
     };
 
     void websocket(const std::string& route, const WebSocketHandler& handler) {
-        this->mSockets[route] = handler;
+        const size_t index = this->mSocketRouter.add(route);
+        if (index == this->mSockets.size())
+            this->mSockets.emplace_back();
+
+        this->mSockets[index] = handler;
+    };
+
+    // Requests served on one connection before it is closed (0 for no limit),
+    // and how long an idle connection is kept open between requests
+    void setKeepAlive(const size_t maxRequests, const std::chrono::seconds timeout) {
+        this->mMaxKeepAliveRequests = maxRequests;
+        this->mKeepAliveTimeout = timeout;
     };
 
+    // Largest header block and (decoded) body accepted before answering 431/413
+    void setRequestLimits(const size_t maxHeaderSize, const size_t maxBodySize) {
+        this->mRequestLimits = { maxHeaderSize, maxBodySize };
+    };
+
+    // Largest WebSocket message (all of its fragments) accepted before closing with 1009
+    void setWebSocketLimits(const size_t maxMessageSize) {
+        this->mWebSocketLimits = { maxMessageSize };
+    };
+
+    // Workers that serve connections (and SO_REUSEPORT listening sockets), one per hardware thread by default
+    static void setWorkerThreads(const unsigned int count) { sMaxWorkerThreads = std::max(1u, count); };
+
+    // Linux only, gives every worker its own SO_REUSEPORT listening socket and
+    // event loop so connections are accepted and served without a shared queue
+    void setReusePort(const bool reusePort) { this->b_mReusePort = reusePort; };
+
+    // Linux only, serves connections from one io_uring per worker when the kernel
+    // supports it, epoll is used otherwise and whenever WebSockets are enabled
+    void setIoUring(const bool useIoUring) { this->b_mUseIoUring = useIoUring; };
+
     void listen(unsigned short port);
     void listen(const char* address, unsigned short port);
     void close();
 
-    static Middleware useStatic(const std::string& directory);
-    static void sendToSocket(Socket_t socket, const std::string& data);
+    static Middleware useStatic(const std::string& directory, const StaticCacheLimits& limits = {});
+    // Blocking write of all of the data, only for sockets that aren't owned by an event loop
+    static bool sendToSocket(Socket_t socket, std::string_view data);
 
 private:
     void listen();
+    void bindSocket(Socket_t socket) const;
+#if defined(__linux__)
+    Socket_t getWorkerSocket(unsigned int workerId);
+    void listenReusePort();
+    void listenIoUring();
+#endif
     void receiveConnections();
     void processRequests(int workerId);
-
-    void upgradeConnection(Socket_t socket, const HttpRequest& request, std::vector<uint8_t>& buffer);
+    void serveConnection(Connection& connection);
+    bool handleConnection(Connection& connection);
+    bool handleRequest(Connection& connection, std::string_view data);
+    void resumeConnection(Connection& connection);
+    void releaseConnection(Connection& connection);
+
+    // Answers the handshake and turns the connection into a WebSocket, false when it wasn't upgraded
+    bool upgradeConnection(Connection& connection, const HttpRequest& request);
+    // Hands every complete message to the handlers, false once the WebSocket is closed
+    bool handleWebSocket(Connection& connection);
     static void upgradeWebSocket(HttpResponse& response, const std::string& mainKey) ;
     static bool isUpgradeRequest(const HttpRequest& request);
 };
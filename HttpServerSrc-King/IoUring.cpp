@@ -0,0 +1,231 @@
+#include "IoUring.hpp"
+
+#if defined(__linux__)
+
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+inline int ioUringSetup(const unsigned entries, io_uring_params* params)
+{
+    return static_cast<int>(syscall(__NR_io_uring_setup, entries, params));
+};
+
+inline int ioUringEnter(const int ringFd, const unsigned toSubmit, const unsigned minComplete, const unsigned flags)
+{
+    return static_cast<int>(syscall(__NR_io_uring_enter, ringFd, toSubmit, minComplete, flags, nullptr, 0));
+};
+
+inline int ioUringRegister(const int ringFd, const unsigned opcode, void* arg, const unsigned count)
+{
+    return static_cast<int>(syscall(__NR_io_uring_register, ringFd, opcode, arg, count));
+};
+
+IoUring::IoUring(const unsigned entries)
+{
+    io_uring_params params{};
+    this->mRingFd = ioUringSetup(entries, &params);
+    if (this->mRingFd < 0) {
+        throw std::runtime_error("Failed to set up io_uring");
+    };
+
+    if (!(params.features & IORING_FEAT_SINGLE_MMAP))
+    {
+        ::close(this->mRingFd);
+        throw std::runtime_error("io_uring is missing IORING_FEAT_SINGLE_MMAP");
+    };
+
+    // Submission and completion rings share one mapping
+    this->mRingSize = std::max(
+        params.sq_off.array + params.sq_entries * sizeof(unsigned),
+        params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe));
+
+    this->mRing = mmap(nullptr, this->mRingSize, PROT_READ | PROT_WRITE,
+        MAP_SHARED | MAP_POPULATE, this->mRingFd, IORING_OFF_SQ_RING);
+    if (this->mRing == MAP_FAILED)
+    {
+        ::close(this->mRingFd);
+        throw std::runtime_error("Failed to map io_uring rings");
+    };
+
+    this->mSqesSize = params.sq_entries * sizeof(io_uring_sqe);
+    this->mSqes = static_cast<io_uring_sqe*>(mmap(nullptr, this->mSqesSize, PROT_READ | PROT_WRITE,
+        MAP_SHARED | MAP_POPULATE, this->mRingFd, IORING_OFF_SQES));
+    if (this->mSqes == MAP_FAILED)
+    {
+        munmap(this->mRing, this->mRingSize);
+        ::close(this->mRingFd);
+        throw std::runtime_error("Failed to map io_uring submission entries");
+    };
+
+    auto* ring = static_cast<char*>(this->mRing);
+    this->mSqHead = reinterpret_cast<unsigned*>(ring + params.sq_off.head);
+    this->mSqTail = reinterpret_cast<unsigned*>(ring + params.sq_off.tail);
+    this->mSqMask = *reinterpret_cast<unsigned*>(ring + params.sq_off.ring_mask);
+    this->mSqEntries = params.sq_entries;
+    this->mSqeTail = this->mSubmitted = *this->mSqTail;
+
+    this->mCqHead = reinterpret_cast<unsigned*>(ring + params.cq_off.head);
+    this->mCqTail = reinterpret_cast<unsigned*>(ring + params.cq_off.tail);
+    this->mCqMask = *reinterpret_cast<unsigned*>(ring + params.cq_off.ring_mask);
+    this->mCqes = reinterpret_cast<io_uring_cqe*>(ring + params.cq_off.cqes);
+
+    // Submission entries are always used in order, so the index array is the identity
+    auto* array = reinterpret_cast<unsigned*>(ring + params.sq_off.array);
+    for (unsigned i = 0; i < this->mSqEntries; ++i)
+        array[i] = i;
+};
+
+IoUring::~IoUring()
+{
+    if (this->mBufferRing != nullptr)
+    {
+        munmap(this->mBufferRing, this->mBufferRingSize);
+        delete[] this->mBuffers;
+    };
+
+    munmap(this->mSqes, this->mSqesSize);
+    munmap(this->mRing, this->mRingSize);
+    ::close(this->mRingFd);
+};
+
+// Multishot receive only came with kernel 6.0, after provided buffer rings and multishot accept (5.19),
+// so one is tried on a socket pair. Kernels without it fail the receive, with it the receive stays armed
+inline bool receivesMultishot()
+{
+    int sockets[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, sockets) < 0)
+        return false;
+
+    bool supported = false;
+    try {
+        IoUring ring{ 2 };
+        ring.registerBuffers(0, 1, 64);
+
+        io_uring_sqe* sqe = ring.getSqe();
+        sqe->opcode = IORING_OP_RECV;
+        sqe->fd = sockets[0];
+        sqe->ioprio = IORING_RECV_MULTISHOT;
+        sqe->flags = IOSQE_BUFFER_SELECT;
+        sqe->buf_group = 0;
+
+        constexpr char byte = 0;
+        if (::write(sockets[1], &byte, 1) == 1 && ring.submit(1) >= 0)
+        {
+            ring.forEachCompletion([&](const io_uring_cqe& cqe) {
+                supported = cqe.res == 1 && (cqe.flags & IORING_CQE_F_MORE);
+            });
+        };
+    }
+    catch (const std::exception&) {};
+
+    ::close(sockets[0]);
+    ::close(sockets[1]);
+    return supported;
+};
+
+bool IoUring::isSupported()
+{
+    io_uring_params params{};
+    const int ringFd = ioUringSetup(2, &params);
+    if (ringFd < 0)
+        return false;
+
+    std::vector<uint8_t> storage(sizeof(io_uring_probe) + 256 * sizeof(io_uring_probe_op));
+    auto* probe = reinterpret_cast<io_uring_probe*>(storage.data());
+
+    bool supported = (params.features & IORING_FEAT_SINGLE_MMAP)
+        && ioUringRegister(ringFd, IORING_REGISTER_PROBE, probe, 256) == 0;
+
+    for (const uint8_t opcode : { IORING_OP_ACCEPT, IORING_OP_RECV, IORING_OP_SEND, IORING_OP_SENDMSG,
+                                  IORING_OP_READ, IORING_OP_SHUTDOWN, IORING_OP_POLL_ADD, IORING_OP_TIMEOUT })
+    {
+        if (!supported)
+            break;
+
+        supported = opcode <= probe->last_op && (probe->ops[opcode].flags & IO_URING_OP_SUPPORTED);
+    };
+
+    ::close(ringFd);
+    return supported && receivesMultishot();
+};
+
+io_uring_sqe* IoUring::getSqe()
+{
+    if (this->mSqeTail - __atomic_load_n(this->mSqHead, __ATOMIC_ACQUIRE) >= this->mSqEntries)
+    {
+        this->submit();
+        if (this->mSqeTail - __atomic_load_n(this->mSqHead, __ATOMIC_ACQUIRE) >= this->mSqEntries)
+            return nullptr;
+    };
+
+    io_uring_sqe* sqe = &this->mSqes[this->mSqeTail & this->mSqMask];
+    std::memset(sqe, 0, sizeof(io_uring_sqe));
+
+    ++this->mSqeTail;
+    return sqe;
+};
+
+int IoUring::submit(const unsigned waitFor)
+{
+    const unsigned toSubmit = this->mSqeTail - this->mSubmitted;
+    __atomic_store_n(this->mSqTail, this->mSqeTail, __ATOMIC_RELEASE);
+    this->mSubmitted = this->mSqeTail;
+
+    if (toSubmit == 0 && waitFor == 0)
+        return 0;
+
+    int result;
+    do {
+        result = ioUringEnter(this->mRingFd, toSubmit, waitFor, waitFor > 0 ? IORING_ENTER_GETEVENTS : 0);
+    } while (result < 0 && errno == EINTR && waitFor == 0);
+
+    return result;
+};
+
+void IoUring::registerBuffers(const uint16_t groupId, const unsigned count, const unsigned size)
+{
+    this->mBufferRingSize = count * sizeof(io_uring_buf);
+    void* memory = mmap(nullptr, this->mBufferRingSize, PROT_READ | PROT_WRITE,
+        MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+    if (memory == MAP_FAILED) {
+        throw std::runtime_error("Failed to map io_uring buffer ring");
+    };
+
+    this->mBufferRing = static_cast<io_uring_buf_ring*>(memory);
+    this->mBufferCount = count;
+    this->mBufferSize = size;
+    this->mBuffers = new char[static_cast<size_t>(count) * size];
+
+    io_uring_buf_reg reg{};
+    reg.ring_addr = reinterpret_cast<uint64_t>(memory);
+    reg.ring_entries = count;
+    reg.bgid = groupId;
+
+    if (ioUringRegister(this->mRingFd, IORING_REGISTER_PBUF_RING, &reg, 1) != 0) {
+        throw std::runtime_error("Failed to register io_uring buffer ring");
+    };
+
+    for (unsigned i = 0; i < count; ++i)
+        this->recycleBuffer(static_cast<uint16_t>(i));
+};
+
+void IoUring::recycleBuffer(const uint16_t bufferId)
+{
+    const uint16_t tail = this->mBufferRing->tail;
+    // Indexed by hand, in C++ the header's flexible array sits past an empty struct member
+    io_uring_buf& buffer = reinterpret_cast<io_uring_buf*>(this->mBufferRing)[tail & (this->mBufferCount - 1)];
+    buffer.addr = reinterpret_cast<uint64_t>(this->getBuffer(bufferId));
+    buffer.len = this->mBufferSize;
+    buffer.bid = bufferId;
+
+    __atomic_store_n(&this->mBufferRing->tail, static_cast<uint16_t>(tail + 1), __ATOMIC_RELEASE);
+};
+
+#endif
@@ -0,0 +1,80 @@
+#ifndef IOURING_HPP
+#define IOURING_HPP
+
+#if defined(__linux__)
+
+#include <cstddef>
+#include <cstdint>
+#include <linux/io_uring.h>
+
+// Minimal io_uring wrapper over the raw syscalls: one submission and
+// completion ring plus a single provided buffer ring for receives
+class IoUring
+{
+private:
+    int mRingFd{ -1 };
+
+    void* mRing{ nullptr };
+    size_t mRingSize{ 0 };
+    io_uring_sqe* mSqes{ nullptr };
+    size_t mSqesSize{ 0 };
+
+    unsigned* mSqHead{ nullptr };
+    unsigned* mSqTail{ nullptr };
+    unsigned mSqMask{ 0 };
+    unsigned mSqEntries{ 0 };
+    unsigned mSqeTail{ 0 };
+    unsigned mSubmitted{ 0 };
+
+    unsigned* mCqHead{ nullptr };
+    unsigned* mCqTail{ nullptr };
+    unsigned mCqMask{ 0 };
+    io_uring_cqe* mCqes{ nullptr };
+
+    io_uring_buf_ring* mBufferRing{ nullptr };
+    size_t mBufferRingSize{ 0 };
+    char* mBuffers{ nullptr };
+    unsigned mBufferCount{ 0 };
+    unsigned mBufferSize{ 0 };
+
+public:
+    explicit IoUring(unsigned entries);
+    ~IoUring();
+
+    IoUring(const IoUring&) = delete;
+    IoUring& operator=(const IoUring&) = delete;
+
+    // Whether the running kernel has every opcode and feature the server relies on
+    static bool isSupported();
+
+    // Next free submission entry, zeroed, submitting queued entries first if the ring is full
+    io_uring_sqe* getSqe();
+    int submit(unsigned waitFor = 0);
+
+    template<typename Fn>
+    unsigned forEachCompletion(Fn&& fn) {
+        unsigned count = 0;
+        unsigned head = *this->mCqHead;
+        while (head != __atomic_load_n(this->mCqTail, __ATOMIC_ACQUIRE))
+        {
+            const io_uring_cqe cqe = this->mCqes[head & this->mCqMask];
+            __atomic_store_n(this->mCqHead, ++head, __ATOMIC_RELEASE);
+
+            fn(cqe);
+            ++count;
+        };
+
+        return count;
+    };
+
+    // Registers count buffers of size bytes under the given group for IOSQE_BUFFER_SELECT
+    void registerBuffers(uint16_t groupId, unsigned count, unsigned size);
+    [[nodiscard]] const char* getBuffer(const uint16_t bufferId) const {
+        return this->mBuffers + static_cast<size_t>(bufferId) * this->mBufferSize;
+    };
+    void recycleBuffer(uint16_t bufferId);
+};
+
+#endif
+
+#endif //IOURING_HPP
@@ -0,0 +1,406 @@
+#include "IoUringLoop.hpp"
+
+#if defined(__linux__)
+
+#include <algorithm>
+#include <cerrno>
+#include <ranges>
+#include <stdexcept>
+
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+
+// user_data layout: descriptor in the high 32 bits, index of the expected
+// length above the low byte, operation in the low byte
+inline uint64_t toUserData(const int descriptor, const uint32_t index, const uint8_t operation)
+{
+    return static_cast<uint64_t>(static_cast<uint32_t>(descriptor)) << 32
+        | static_cast<uint64_t>(index & 0xffffff) << 8 | operation;
+};
+
+IoUringLoop::IoUringLoop(const Socket_t serverSocket, DispatchFn dispatch,
+    const std::chrono::steady_clock::duration idleTimeout, const RequestLimits& limits)
+    : mIdleTimeout(idleTimeout), mLimits(limits), mServerSocket(serverSocket), mDispatch(std::move(dispatch))
+{
+    this->mWakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (this->mWakeFd < 0) {
+        throw std::runtime_error("Failed to create eventfd");
+    };
+
+    this->mRing.registerBuffers(sBufferGroup, sBufferCount, sBufferSize);
+};
+
+IoUringLoop::~IoUringLoop()
+{
+    if (this->mWakeFd >= 0)
+        ::close(this->mWakeFd);
+};
+
+void IoUringLoop::run()
+{
+    this->b_mIsRunning = true;
+
+    this->submitAccept();
+    this->submitWake();
+    this->submitTimeout();
+
+    while (this->b_mIsRunning)
+    {
+        if (this->mRing.submit(1) < 0 && errno != EINTR && errno != EAGAIN && errno != EBUSY)
+            break;
+
+        this->mRing.forEachCompletion([this](const io_uring_cqe& cqe) {
+            this->handleCompletion(cqe);
+        });
+    };
+};
+
+void IoUringLoop::stop()
+{
+    this->b_mIsRunning = false;
+
+    constexpr uint64_t value = 1;
+    [[maybe_unused]] const auto _ = write(this->mWakeFd, &value, sizeof(value));
+};
+
+void IoUringLoop::rearm(const Connection& connection)
+{
+    const auto& it = this->mStates.find(connection.mSocket);
+    if (it == this->mStates.end())
+        return;
+
+    State& state = it->second;
+    state.connection->mLastActivity = std::chrono::steady_clock::now();
+    state.connection->b_mIsBusy.store(false, std::memory_order_relaxed);
+    this->submitOutput(state);
+};
+
+void IoUringLoop::release(const Connection& connection)
+{
+    const auto& it = this->mStates.find(connection.mSocket);
+    if (it == this->mStates.end())
+        return;
+
+    // The connection is dropped once the queued output and the shutdown have completed
+    State& state = it->second;
+    state.isClosing = true;
+    state.connection->b_mIsBusy.store(false, std::memory_order_relaxed);
+    this->submitOutput(state);
+};
+
+io_uring_sqe* IoUringLoop::prepare(const Operation operation, const int descriptor, const uint32_t index)
+{
+    io_uring_sqe* sqe = this->mRing.getSqe();
+    if (sqe == nullptr) {
+        throw std::runtime_error("io_uring submission queue is full");
+    };
+
+    sqe->fd = descriptor;
+    sqe->user_data = toUserData(descriptor, index, operation);
+    return sqe;
+};
+
+void IoUringLoop::handleCompletion(const io_uring_cqe& cqe)
+{
+    const int descriptor = static_cast<int>(cqe.user_data >> 32);
+    const auto operation = static_cast<Operation>(cqe.user_data & 0xff);
+
+    switch (operation)
+    {
+        case Accept:
+            this->onAccept(cqe);
+            return;
+
+        case Wake: {
+            uint64_t value;
+            while (read(this->mWakeFd, &value, sizeof(value)) > 0) {};
+
+            if (this->b_mIsRunning)
+                this->submitWake();
+            return;
+        };
+
+        case Timeout:
+            this->closeIdleConnections();
+            this->submitTimeout();
+            return;
+
+        default:
+            break;
+    };
+
+    const auto& it = this->mStates.find(descriptor);
+    if (it == this->mStates.end())
+        return;
+
+    State& state = it->second;
+    if (operation == Receive)
+        this->onReceive(state, cqe);
+    else this->onSend(state, cqe);
+
+    // Nothing references the socket anymore, dropping the connection closes it
+    if (state.isClosing && state.operations == 0)
+        this->mStates.erase(descriptor);
+};
+
+void IoUringLoop::submitAccept()
+{
+    io_uring_sqe* sqe = this->prepare(Accept, this->mServerSocket);
+    sqe->opcode = IORING_OP_ACCEPT;
+    sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+    sqe->accept_flags = SOCK_CLOEXEC;
+};
+
+void IoUringLoop::submitWake()
+{
+    io_uring_sqe* sqe = this->prepare(Wake, this->mWakeFd);
+    sqe->opcode = IORING_OP_POLL_ADD;
+    sqe->poll32_events = POLLIN;
+};
+
+void IoUringLoop::submitTimeout()
+{
+    io_uring_sqe* sqe = this->prepare(Timeout, -1);
+    sqe->opcode = IORING_OP_TIMEOUT;
+    sqe->addr = reinterpret_cast<uint64_t>(&this->mSweepInterval);
+    sqe->len = 1;
+};
+
+void IoUringLoop::submitReceive(State& state)
+{
+    io_uring_sqe* sqe = this->prepare(Receive, state.connection->mSocket);
+    sqe->opcode = IORING_OP_RECV;
+    sqe->ioprio = IORING_RECV_MULTISHOT;
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = sBufferGroup;
+
+    state.isReceiving = true;
+    ++state.operations;
+};
+
+void IoUringLoop::submitOutput(State& state)
+{
+    // Only one chain per connection is in flight, the next one goes out once it completes
+    if (state.sendOperations > 0)
+        return;
+
+    state.sending.clear();
+    state.fileBuffers.clear();
+    state.vectors.clear();
+    state.messages.clear();
+    state.lengths.clear();
+
+    Connection& connection = *state.connection;
+    for (auto& segment : connection.mOutput.take())
+        state.backlog.push_back(std::move(segment));
+
+    const Socket_t socket = connection.mSocket;
+    io_uring_sqe* last = nullptr;
+    size_t fileBytes = 0;
+    while (!state.backlog.empty() && fileBytes < sFileChunkSize)
+    {
+        OutputQueue::Segment& segment = state.backlog.front();
+        const auto index = static_cast<uint32_t>(state.lengths.size());
+
+        if (!segment.file)
+        {
+            // A run of in-memory segments goes out as one gathered sendmsg
+            std::vector<iovec>& vectors = state.vectors.emplace_back();
+            size_t length = 0;
+            while (!state.backlog.empty() && !state.backlog.front().file && vectors.size() < sMaxVectors)
+            {
+                OutputQueue::Segment& sending = state.sending.emplace_back(std::move(state.backlog.front()));
+                state.backlog.pop_front();
+
+                const std::string_view bytes = sending.bytes();
+                vectors.push_back({ const_cast<char*>(bytes.data()), bytes.size() });
+                length += bytes.size();
+            };
+
+            msghdr& message = state.messages.emplace_back();
+            message.msg_iov = vectors.data();
+            message.msg_iovlen = vectors.size();
+            state.lengths.push_back(length);
+
+            last = this->prepare(Send, socket, index);
+            last->opcode = IORING_OP_SENDMSG;
+            last->addr = reinterpret_cast<uint64_t>(&message);
+            last->len = 1;
+            last->msg_flags = MSG_WAITALL | MSG_NOSIGNAL;
+            last->flags = IOSQE_IO_LINK;
+            ++state.sendOperations;
+            continue;
+        };
+
+        // Files are read into memory by a read linked ahead of their send
+        const size_t length = std::min(segment.length, sFileChunkSize - fileBytes);
+        char* buffer = state.fileBuffers.emplace_back(std::make_unique<char[]>(length)).get();
+        state.sending.push_back({ {}, segment.file, segment.offset, length });
+        state.lengths.push_back(length);
+
+        // Tagged with the socket so the completion finds its connection
+        io_uring_sqe* sqe = this->prepare(Read, socket, index);
+        sqe->opcode = IORING_OP_READ;
+        sqe->fd = segment.file->get();
+        sqe->addr = reinterpret_cast<uint64_t>(buffer);
+        sqe->len = static_cast<uint32_t>(length);
+        sqe->off = segment.offset;
+        sqe->flags = IOSQE_IO_LINK;
+
+        last = this->prepare(Send, socket, index);
+        last->opcode = IORING_OP_SEND;
+        last->addr = reinterpret_cast<uint64_t>(buffer);
+        last->len = static_cast<uint32_t>(length);
+        last->msg_flags = MSG_WAITALL | MSG_NOSIGNAL;
+        last->flags = IOSQE_IO_LINK;
+        state.sendOperations += 2;
+
+        segment.offset += length;
+        segment.length -= length;
+        fileBytes += length;
+        if (segment.length == 0)
+            state.backlog.pop_front();
+    };
+
+    state.operations += state.sendOperations;
+
+    const bool shouldShutdown = state.isClosing && state.backlog.empty() && !state.isShutdown;
+    if (last != nullptr && shouldShutdown)
+    {
+        // Linked behind the last send, so the peer reads every response before the FIN
+        this->submitShutdown(state);
+        ++state.sendOperations;
+        return;
+    };
+
+    if (last != nullptr)
+        last->flags &= ~IOSQE_IO_LINK;
+    else if (shouldShutdown && state.isReceiving)
+        this->submitShutdown(state);
+};
+
+void IoUringLoop::submitShutdown(State& state)
+{
+    io_uring_sqe* sqe = this->prepare(Shutdown, state.connection->mSocket);
+    sqe->opcode = IORING_OP_SHUTDOWN;
+    sqe->len = SHUT_RDWR;
+
+    state.isShutdown = true;
+    ++state.operations;
+};
+
+void IoUringLoop::onAccept(const io_uring_cqe& cqe)
+{
+    if (!(cqe.flags & IORING_CQE_F_MORE) && this->b_mIsRunning)
+        this->submitAccept();
+
+    if (cqe.res < 0)
+        return;
+
+    const auto& connection = std::make_shared<Connection>(cqe.res, this->mLimits);
+    connection->mIoUringLoop = this;
+
+    State& state = this->mStates[cqe.res];
+    state = State{};
+    state.connection = connection;
+    this->submitReceive(state);
+};
+
+void IoUringLoop::onReceive(State& state, const io_uring_cqe& cqe)
+{
+    Connection& connection = *state.connection;
+    if (!(cqe.flags & IORING_CQE_F_MORE))
+    {
+        state.isReceiving = false;
+        --state.operations;
+    };
+
+    if (cqe.flags & IORING_CQE_F_BUFFER)
+    {
+        const auto bufferId = static_cast<uint16_t>(cqe.flags >> IORING_CQE_BUFFER_SHIFT);
+        if (cqe.res > 0)
+            connection.mBuffer.append(this->mRing.getBuffer(bufferId), cqe.res);
+
+        this->mRing.recycleBuffer(bufferId);
+    };
+
+    if (state.isClosing)
+        return;
+
+    // Out of provided buffers only pauses the receive, anything else ends the connection
+    if (cqe.res <= 0 && cqe.res != -ENOBUFS)
+    {
+        state.isClosing = true;
+        this->submitOutput(state);
+        return;
+    };
+
+    connection.mLastActivity = std::chrono::steady_clock::now();
+    if (cqe.res > 0 && !connection.b_mIsBusy.load(std::memory_order_relaxed))
+    {
+        if (connection.readRequest() != RequestReader::Status::Incomplete)
+        {
+            // Handlers run right here, they end by rearming or releasing the connection
+            connection.b_mIsBusy.store(true, std::memory_order_relaxed);
+            this->mDispatch(state.connection);
+        }
+        else this->submitOutput(state);
+    };
+
+    if (!state.isReceiving && !state.isClosing)
+        this->submitReceive(state);
+};
+
+void IoUringLoop::onSend(State& state, const io_uring_cqe& cqe)
+{
+    const auto operation = static_cast<Operation>(cqe.user_data & 0xff);
+    --state.operations;
+
+    // A shutdown submitted on its own, outside of any chain
+    if (state.sendOperations == 0)
+        return;
+
+    --state.sendOperations;
+    if (cqe.res < 0)
+    {
+        state.isFailed = true;
+        if (operation == Shutdown)
+            state.isShutdown = false;
+    }
+    else if (operation != Shutdown)
+    {
+        const auto index = static_cast<uint32_t>(cqe.user_data >> 8 & 0xffffff);
+        if (static_cast<size_t>(cqe.res) != state.lengths[index])
+            state.isFailed = true;
+    };
+
+    if (state.sendOperations > 0)
+        return;
+
+    if (state.isFailed)
+    {
+        // Whatever was queued behind a failed send can't be delivered anymore
+        state.isClosing = true;
+        state.backlog.clear();
+        state.connection->mOutput.clear();
+    };
+
+    this->submitOutput(state);
+};
+
+void IoUringLoop::closeIdleConnections()
+{
+    const auto& now = std::chrono::steady_clock::now();
+    for (auto& state : this->mStates | std::views::values)
+    {
+        if (state.isClosing || state.sendOperations > 0
+            || now - state.connection->mLastActivity < this->mIdleTimeout)
+            continue;
+
+        state.isClosing = true;
+        this->submitOutput(state);
+    };
+};
+
+#endif
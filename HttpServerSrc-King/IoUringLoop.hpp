@@ -0,0 +1,118 @@
+#ifndef IOURINGLOOP_HPP
+#define IOURINGLOOP_HPP
+
+#if defined(__linux__)
+
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include <sys/socket.h>
+
+#include "Common.hpp"
+#include "Connection.hpp"
+#include "IoUring.hpp"
+#include "OutputQueue.hpp"
+
+// io_uring counterpart of EventLoop, accepts with a multishot accept, receives
+// into provided buffers with multishot receives and writes every batch of
+// responses as one chain of linked sends (file segments are read into memory
+// by a linked read first). Requests are dispatched on the loop thread.
+class IoUringLoop
+{
+public:
+    using DispatchFn = std::function<void(std::shared_ptr<Connection>)>;
+
+private:
+    static constexpr unsigned sRingEntries = 1024;
+    static constexpr unsigned sBufferCount = 512;
+    static constexpr unsigned sBufferSize = 16384;
+    static constexpr uint16_t sBufferGroup = 0;
+    static constexpr size_t sFileChunkSize = 262144;
+    static constexpr size_t sMaxVectors = 64;
+
+    enum Operation : uint8_t {
+        Accept,
+        Receive,
+        Read,
+        Send,
+        Shutdown,
+        Wake,
+        Timeout
+    };
+
+    struct State {
+        std::shared_ptr<Connection> connection{};
+        // Segments and file buffers referenced by the chain currently in flight,
+        // a deque so the strings the kernel reads from never move
+        std::deque<OutputQueue::Segment> sending{};
+        std::vector<std::unique_ptr<char[]>> fileBuffers{};
+        std::deque<std::vector<iovec>> vectors{};
+        std::deque<msghdr> messages{};
+        // Bytes each read or send of the chain has to complete with
+        std::vector<size_t> lengths{};
+        // Output left over once a chain holds sFileChunkSize bytes of files
+        std::deque<OutputQueue::Segment> backlog{};
+        unsigned operations{ 0 };
+        unsigned sendOperations{ 0 };
+        bool isReceiving{ false };
+        bool isClosing{ false };
+        bool isShutdown{ false };
+        bool isFailed{ false };
+    };
+
+    std::atomic<bool> b_mIsRunning{ false };
+    std::chrono::steady_clock::duration mIdleTimeout{};
+    RequestLimits mLimits{};
+    __kernel_timespec mSweepInterval{ 1, 0 };
+    uint64_t mWakeValue{ 0 };
+
+    std::unordered_map<int, State> mStates{};
+    IoUring mRing{ sRingEntries };
+
+protected:
+    int mWakeFd{ -1 };
+    Socket_t mServerSocket{ 0 };
+    DispatchFn mDispatch{};
+
+public:
+    IoUringLoop(Socket_t serverSocket, DispatchFn dispatch,
+        std::chrono::steady_clock::duration idleTimeout, const RequestLimits& limits);
+    ~IoUringLoop();
+
+    IoUringLoop(const IoUringLoop&) = delete;
+    IoUringLoop& operator=(const IoUringLoop&) = delete;
+
+    void run();
+    void stop();
+
+    // Sends whatever the handlers queued and keeps receiving
+    void rearm(const Connection& connection);
+    // Sends whatever the handlers queued, then shuts the socket down
+    void release(const Connection& connection);
+
+private:
+    io_uring_sqe* prepare(Operation operation, int descriptor, uint32_t index = 0);
+    void handleCompletion(const io_uring_cqe& cqe);
+
+    void submitAccept();
+    void submitWake();
+    void submitTimeout();
+    void submitReceive(State& state);
+    void submitOutput(State& state);
+    void submitShutdown(State& state);
+
+    void onAccept(const io_uring_cqe& cqe);
+    void onReceive(State& state, const io_uring_cqe& cqe);
+    void onSend(State& state, const io_uring_cqe& cqe);
+
+    void closeIdleConnections();
+};
+
+#endif
+
+#endif //IOURINGLOOP_HPP
@@ -0,0 +1,52 @@
+#ifndef MIDDLEWARECHAIN_HPP
+#define MIDDLEWARECHAIN_HPP
+
+#include <cstddef>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#include "Common.hpp"
+
+// The middlewares of a route, composed when the route is registered. Each stage
+// calls the next one directly: a handler without next is followed by the next
+// stage inline, one with next gets a NextFn pointing at the stage after it
+template<typename... Handlers>
+class MiddlewareChain
+{
+private:
+    std::tuple<Handlers...> mHandlers;
+
+public:
+    explicit MiddlewareChain(Handlers... handlers) : mHandlers(std::move(handlers)...) {};
+
+    void operator()(const HttpRequest& request, HttpResponse& response, const NextFn& next) {
+        this->invoke<0>(request, response, next);
+    };
+
+private:
+    template<size_t Index>
+    void invoke(const HttpRequest& request, HttpResponse& response, const NextFn& next) {
+        if constexpr (Index == sizeof...(Handlers)) {
+            next();
+        }
+        else {
+            auto& handler = std::get<Index>(this->mHandlers);
+            using Handler = std::tuple_element_t<Index, std::tuple<Handlers...>>;
+
+            if constexpr (std::is_invocable_v<Handler&, const HttpRequest&, HttpResponse&, NextFn>) {
+                const auto& rest = [this, &request, &response, &next]() {
+                    this->invoke<Index + 1>(request, response, next);
+                };
+
+                handler(request, response, NextFn{ rest });
+            }
+            else {
+                handler(request, response);
+                this->invoke<Index + 1>(request, response, next);
+            };
+        };
+    };
+};
+
+#endif //MIDDLEWARECHAIN_HPP
@@ -0,0 +1,212 @@
+#include <algorithm>
+#include <array>
+#include <cerrno>
+
+#if defined(_WIN32)
+    #include <io.h>
+#elif defined(__unix__) || defined(__APPLE__)
+    #include <climits>
+    #include <sys/socket.h>
+    #include <sys/uio.h>
+#endif
+
+#if defined(__linux__)
+    #include <sys/sendfile.h>
+#endif
+
+#include "OutputQueue.hpp"
+#include "HttpServer.hpp"
+
+#if defined(MSG_NOSIGNAL)
+constexpr int sSendFlags = MSG_NOSIGNAL;
+#else
+constexpr int sSendFlags = 0;
+#endif
+
+FileHandle::~FileHandle()
+{
+    if (this->mDescriptor < 0)
+        return;
+
+#if defined(_WIN32)
+    ::_close(this->mDescriptor);
+#elif defined(__unix__) || defined(__APPLE__)
+    ::close(this->mDescriptor);
+#endif
+};
+
+void OutputQueue::append(const std::string_view data)
+{
+    if (data.empty())
+        return;
+
+    // Consecutive small writes share one segment so headers and small bodies go out together,
+    // a large body segment is never grown (and reallocated) to take the next response
+    if (this->mSegments.empty() || this->mSegments.back().file || this->mSegments.back().shared
+        || this->mSegments.back().data.size() >= sCoalesceSize)
+        this->mSegments.emplace_back();
+
+    this->mSegments.back().data.append(data);
+    this->mSize += data.size();
+};
+
+void OutputQueue::append(std::string&& data)
+{
+    if (data.size() < sCoalesceSize)
+    {
+        this->append(std::string_view{ data });
+        return;
+    };
+
+    this->mSize += data.size();
+    this->mSegments.push_back({ std::move(data) });
+};
+
+void OutputQueue::append(std::shared_ptr<const std::string> data, const size_t offset, size_t length)
+{
+    if (!data || offset >= data->size())
+        return;
+
+    length = std::min(length, data->size() - offset);
+    if (length < sCoalesceSize)
+    {
+        this->append(std::string_view{ *data }.substr(offset, length));
+        return;
+    };
+
+    this->mSize += length;
+    this->mSegments.push_back({ {}, {}, offset, length, std::move(data) });
+};
+
+void OutputQueue::appendFile(std::shared_ptr<FileHandle> file, const size_t offset, const size_t length)
+{
+    if (length == 0)
+        return;
+
+    this->mSegments.push_back({ {}, std::move(file), offset, length });
+};
+
+std::deque<OutputQueue::Segment> OutputQueue::take()
+{
+    std::deque<Segment> segments = std::move(this->mSegments);
+    this->clear();
+    return segments;
+};
+
+void OutputQueue::clear()
+{
+    this->mSegments.clear();
+    this->mSize = 0;
+};
+
+void OutputQueue::consume(size_t bytesSent)
+{
+    while (bytesSent > 0)
+    {
+        Segment& segment = this->mSegments.front();
+        const size_t left = segment.bytes().size();
+        const size_t sent = std::min(bytesSent, left);
+
+        this->mSize -= sent;
+        bytesSent -= sent;
+        if (sent == left)
+        {
+            this->mSegments.pop_front();
+            continue;
+        };
+
+        segment.offset += sent;
+        if (segment.shared)
+            segment.length -= sent;
+    };
+};
+
+OutputQueue::WriteStatus OutputQueue::writeTo(const Socket_t socket)
+{
+#if defined(_WIN32)
+    // Windows sockets are always blocking, and never take file segments
+    while (!this->mSegments.empty())
+    {
+        if (const Segment& segment = this->mSegments.front(); !segment.file)
+        {
+            if (!HttpServer::sendToSocket(socket, segment.bytes()))
+                return WriteStatus::Failed;
+
+            this->mSize -= segment.bytes().size();
+        };
+
+        this->mSegments.pop_front();
+    };
+
+    return WriteStatus::Done;
+#elif defined(__unix__) || defined(__APPLE__)
+    while (!this->mSegments.empty())
+    {
+        // Every run of in-memory segments goes out in a single sendmsg(), writev() with flags
+        // so a peer that reset the connection doesn't raise SIGPIPE
+        if (!this->mSegments.front().file)
+        {
+            std::array<iovec, std::min(IOV_MAX, 64)> vectors;
+            size_t count = 0;
+            for (auto it = this->mSegments.begin(); it != this->mSegments.end() && !it->file && count < vectors.size(); ++it)
+                vectors[count++] = { const_cast<char*>(it->bytes().data()), it->bytes().size() };
+
+            msghdr message{};
+            message.msg_iov = vectors.data();
+            message.msg_iovlen = count;
+
+            const ssize_t bytesSent = ::sendmsg(socket, &message, sSendFlags);
+            if (bytesSent < 0)
+            {
+                if (errno == EINTR)
+                    continue;
+
+                // Sockets owned by the event loop are non-blocking, it finishes the write once they take data again
+                return errno == EAGAIN || errno == EWOULDBLOCK ? WriteStatus::Pending : WriteStatus::Failed;
+            };
+
+            this->consume(static_cast<size_t>(bytesSent));
+            continue;
+        };
+
+        Segment& segment = this->mSegments.front();
+#if defined(__linux__)
+        // Straight from the page cache to the socket, the file never passes through user space.
+        // sendfile() takes no flags, listen() ignores SIGPIPE for it
+        auto offset = static_cast<off_t>(segment.offset);
+        const ssize_t bytesSent = ::sendfile(socket, segment.file->get(), &offset, segment.length);
+        if (bytesSent < 0)
+        {
+            if (errno == EINTR)
+                continue;
+
+            return errno == EAGAIN || errno == EWOULDBLOCK ? WriteStatus::Pending : WriteStatus::Failed;
+        };
+
+        // Also reached when the file shrank underneath us
+        if (bytesSent == 0)
+            return WriteStatus::Failed;
+
+        segment.offset += static_cast<size_t>(bytesSent);
+        segment.length -= static_cast<size_t>(bytesSent);
+#else
+        std::array<char, sFileChunkSize> chunk;
+        const size_t count = std::min(chunk.size(), segment.length);
+        const ssize_t bytesRead = pread(segment.file->get(), chunk.data(), count, static_cast<off_t>(segment.offset));
+        if (bytesRead <= 0)
+            return WriteStatus::Failed;
+
+        // Only reached with blocking sockets, the event loop is Linux only
+        if (!HttpServer::sendToSocket(socket, std::string_view{ chunk.data(), static_cast<size_t>(bytesRead) }))
+            return WriteStatus::Failed;
+
+        segment.offset += static_cast<size_t>(bytesRead);
+        segment.length -= static_cast<size_t>(bytesRead);
+#endif
+        if (segment.length == 0)
+            this->mSegments.pop_front();
+    };
+
+    return WriteStatus::Done;
+#endif
+};
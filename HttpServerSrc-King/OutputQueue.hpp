@@ -0,0 +1,94 @@
+#ifndef OUTPUTQUEUE_HPP
+#define OUTPUTQUEUE_HPP
+
+#include <deque>
+#include <memory>
+#include <string>
+#include <string_view>
+
+#include "Common.hpp"
+
+// Open file descriptor shared by the queued segments that are sent from it
+class FileHandle
+{
+protected:
+    int mDescriptor{ -1 };
+
+public:
+    explicit FileHandle(const int descriptor) : mDescriptor(descriptor) {};
+    ~FileHandle();
+
+    FileHandle(const FileHandle&) = delete;
+    FileHandle& operator=(const FileHandle&) = delete;
+
+    [[nodiscard]] int get() const { return this->mDescriptor; };
+};
+
+// Responses waiting to be written to a connection, in order, as runs of
+// bytes or ranges of an open file
+class OutputQueue
+{
+public:
+    struct Segment {
+        std::string data{};
+        std::shared_ptr<FileHandle> file{};
+        size_t offset{ 0 };
+        size_t length{ 0 };
+        // Bytes owned elsewhere as well (a cached file), offset and length of them are sent in place of data
+        std::shared_ptr<const std::string> shared{};
+
+        // What's left to send, the offset moves past whatever was written already
+        [[nodiscard]] std::string_view bytes() const {
+            if (this->shared)
+                return std::string_view{ *this->shared }.substr(this->offset, this->length);
+
+            return std::string_view{ this->data }.substr(this->offset);
+        };
+    };
+
+    enum class WriteStatus {
+        Done,
+        // The socket took what it could, the rest is still queued
+        Pending,
+        Failed
+    };
+
+private:
+    static constexpr size_t sFileChunkSize = 65536;
+    static constexpr size_t sCoalesceSize = 4096;
+
+    std::deque<Segment> mSegments{};
+    size_t mSize{ 0 };
+    bool b_mAcceptsFiles{ false };
+
+public:
+    void append(std::string_view data);
+    // Takes over a large buffer as its own segment instead of copying it
+    void append(std::string&& data);
+    // Queues (part of) a buffer that's shared with others without copying it
+    void append(std::shared_ptr<const std::string> data, size_t offset = 0, size_t length = std::string::npos);
+    void appendFile(std::shared_ptr<FileHandle> file, size_t offset, size_t length);
+
+    [[nodiscard]] bool empty() const { return this->mSegments.empty(); };
+    // Bytes held in memory, file ranges are not counted
+    [[nodiscard]] size_t size() const { return this->mSize; };
+    [[nodiscard]] const std::deque<Segment>& getSegments() const { return this->mSegments; };
+    // Moves every queued segment out, leaving the queue empty
+    std::deque<Segment> take();
+    void clear();
+
+    // Whoever drains the queue can send file segments (every unix connection),
+    // otherwise responses inline file contents
+    [[nodiscard]] bool acceptsFiles() const { return this->b_mAcceptsFiles; };
+    void setAcceptsFiles(const bool acceptsFiles) { this->b_mAcceptsFiles = acceptsFiles; };
+
+    // Writes queued segments until the socket stops taking data, runs of bytes go out with
+    // sendmsg() and file ranges with sendfile() on Linux. Whatever was written leaves the queue
+    WriteStatus writeTo(Socket_t socket);
+
+private:
+    // Drops the bytes a write took off the front of the queue
+    void consume(size_t bytesSent);
+};
+
+#endif //OUTPUTQUEUE_HPP
@@ -0,0 +1,593 @@
+#include <algorithm>
+#include <cctype>
+#include <map>
+#include <stdexcept>
+
+#include "RegexSet.hpp"
+
+struct RegexNode {
+    enum Kind { Set, Concat, Alternate, Repeat };
+
+    static constexpr uint32_t sUnbounded = std::numeric_limits<uint32_t>::max();
+
+    Kind kind{ Concat };
+    uint32_t set{ 0 };
+    uint32_t min{ 0 };
+    uint32_t max{ 0 };
+    std::vector<RegexNode> children{};
+};
+
+// Recursive descent over the supported subset, throws std::invalid_argument on anything else
+class RegexParser
+{
+private:
+    static constexpr uint32_t sMaxRepeat = 1000;
+
+    std::string_view mPattern{};
+    size_t mPosition{ 0 };
+    std::vector<std::bitset<256>>& mSets;
+
+public:
+    RegexParser(const std::string_view pattern, std::vector<std::bitset<256>>& sets)
+        : mPattern(pattern), mSets(sets) {};
+
+    RegexNode parse()
+    {
+        // Patterns have to match the whole input anyway, so a leading ^ changes nothing
+        if (this->mPattern.starts_with('^'))
+            ++this->mPosition;
+
+        RegexNode node = this->alternation();
+        if (this->mPosition != this->mPattern.size())
+            throw std::invalid_argument("Unexpected character in pattern");
+
+        return node;
+    };
+
+private:
+    [[nodiscard]] bool atEnd() const { return this->mPosition >= this->mPattern.size(); };
+    [[nodiscard]] char peek() const { return this->atEnd() ? '\0' : this->mPattern[this->mPosition]; };
+
+    RegexNode makeSet(const std::bitset<256>& set)
+    {
+        this->mSets.push_back(set);
+        return { RegexNode::Set, static_cast<uint32_t>(this->mSets.size() - 1) };
+    };
+
+    RegexNode alternation()
+    {
+        RegexNode node{ RegexNode::Alternate };
+        node.children.push_back(this->concatenation());
+        while (this->peek() == '|' && !this->atEnd())
+        {
+            ++this->mPosition;
+            node.children.push_back(this->concatenation());
+        };
+
+        if (node.children.size() == 1)
+            return std::move(node.children.front());
+
+        return node;
+    };
+
+    RegexNode concatenation()
+    {
+        RegexNode node{ RegexNode::Concat };
+        while (!this->atEnd() && this->peek() != '|' && this->peek() != ')')
+            node.children.push_back(this->repetition());
+
+        if (node.children.size() == 1)
+            return std::move(node.children.front());
+
+        return node;
+    };
+
+    RegexNode repetition()
+    {
+        RegexNode atom = this->atom();
+
+        uint32_t min = 0;
+        uint32_t max = 0;
+        switch (this->peek())
+        {
+            case '*': min = 0; max = RegexNode::sUnbounded; break;
+            case '+': min = 1; max = RegexNode::sUnbounded; break;
+            case '?': min = 0; max = 1; break;
+            case '{': {
+                ++this->mPosition;
+                min = max = this->number();
+                if (this->peek() == ',')
+                {
+                    ++this->mPosition;
+                    max = this->peek() == '}' ? RegexNode::sUnbounded : this->number();
+                };
+
+                if (this->peek() != '}' || min > max || min > sMaxRepeat
+                    || (max != RegexNode::sUnbounded && max > sMaxRepeat))
+                    throw std::invalid_argument("Invalid repetition");
+
+                break;
+            };
+
+            default:
+                return atom;
+        };
+
+        ++this->mPosition;
+        // Lazy or greedy makes no difference when only asking whether the whole input matches
+        if (this->peek() == '?')
+            ++this->mPosition;
+
+        RegexNode node{ RegexNode::Repeat };
+        node.min = min;
+        node.max = max;
+        node.children.push_back(std::move(atom));
+        return node;
+    };
+
+    uint32_t number()
+    {
+        const size_t start = this->mPosition;
+        uint32_t value = 0;
+        while (this->peek() >= '0' && this->peek() <= '9' && this->mPosition - start < 6)
+            value = value * 10 + (this->mPattern[this->mPosition++] - '0');
+
+        if (this->mPosition == start)
+            throw std::invalid_argument("Expected a number");
+
+        return value;
+    };
+
+    RegexNode atom()
+    {
+        const char character = this->mPattern[this->mPosition++];
+        switch (character)
+        {
+            case '(': {
+                if (this->peek() == '?')
+                {
+                    if (this->mPattern.substr(this->mPosition, 2) != "?:")
+                        throw std::invalid_argument("Lookarounds are not supported");
+
+                    this->mPosition += 2;
+                };
+
+                RegexNode node = this->alternation();
+                if (this->peek() != ')' || this->atEnd())
+                    throw std::invalid_argument("Unbalanced group");
+
+                ++this->mPosition;
+                return node;
+            };
+
+            case '[':
+                return this->makeSet(this->characterClass());
+
+            case '.': {
+                std::bitset<256> set;
+                set.set();
+                set.reset('\n');
+                set.reset('\r');
+                return this->makeSet(set);
+            };
+
+            case '\\':
+                return this->makeSet(this->escape(false));
+
+            case '$':
+                if (this->atEnd())
+                    return { RegexNode::Concat };
+
+                throw std::invalid_argument("Anchors are only supported at the ends");
+
+            case '^': case '*': case '+': case '?': case '{': case '}': case ']': case ')': case '|':
+                throw std::invalid_argument("Unexpected character in pattern");
+
+            default: {
+                std::bitset<256> set;
+                set.set(static_cast<uint8_t>(character));
+                return this->makeSet(set);
+            };
+        };
+    };
+
+    std::bitset<256> characterClass()
+    {
+        const bool isNegated = this->peek() == '^';
+        if (isNegated)
+            ++this->mPosition;
+
+        std::bitset<256> set;
+        while (this->peek() != ']')
+        {
+            if (this->atEnd())
+                throw std::invalid_argument("Unterminated character class");
+
+            std::bitset<256> first;
+            std::optional<uint8_t> low = this->classCharacter(first);
+
+            // A '-' that isn't last makes a range, between single characters only
+            if (this->peek() == '-' && this->mPattern.substr(this->mPosition + 1, 1) != "]"
+                && this->mPosition + 1 < this->mPattern.size())
+            {
+                ++this->mPosition;
+                std::bitset<256> last;
+                const std::optional<uint8_t> high = this->classCharacter(last);
+                if (!low.has_value() || !high.has_value() || low.value() > high.value())
+                    throw std::invalid_argument("Invalid character class range");
+
+                for (unsigned value = low.value(); value <= high.value(); ++value)
+                    set.set(value);
+
+                continue;
+            };
+
+            set |= first;
+        };
+
+        ++this->mPosition;
+        return isNegated ? ~set : set;
+    };
+
+    // The character at the cursor, or nothing when it's an escape like \d standing for several
+    std::optional<uint8_t> classCharacter(std::bitset<256>& set)
+    {
+        if (this->peek() == '\\')
+        {
+            ++this->mPosition;
+            set = this->escape(true);
+            if (set.count() != 1)
+                return std::nullopt;
+
+            for (unsigned value = 0; value < 256; ++value)
+            {
+                if (set.test(value))
+                    return static_cast<uint8_t>(value);
+            };
+        };
+
+        const auto value = static_cast<uint8_t>(this->mPattern[this->mPosition++]);
+        set.set(value);
+        return value;
+    };
+
+    std::bitset<256> escape(const bool inClass)
+    {
+        if (this->atEnd())
+            throw std::invalid_argument("Trailing backslash");
+
+        const char character = this->mPattern[this->mPosition++];
+        std::bitset<256> set;
+        const auto& range = [&set](const char first, const char last) {
+            for (int value = first; value <= last; ++value)
+                set.set(static_cast<uint8_t>(value));
+        };
+
+        switch (character)
+        {
+            case 'd': case 'D':
+                range('0', '9');
+                break;
+
+            case 'w': case 'W':
+                range('0', '9');
+                range('A', 'Z');
+                range('a', 'z');
+                set.set('_');
+                break;
+
+            case 's': case 'S':
+                for (const char space : { ' ', '\t', '\n', '\r', '\f', '\v' })
+                    set.set(static_cast<uint8_t>(space));
+                break;
+
+            case 't': set.set('\t'); return set;
+            case 'n': set.set('\n'); return set;
+            case 'r': set.set('\r'); return set;
+            case 'f': set.set('\f'); return set;
+            case 'v': set.set('\v'); return set;
+
+            case '0':
+                if (this->peek() >= '0' && this->peek() <= '9')
+                    throw std::invalid_argument("Octal escapes are not supported");
+
+                set.set(0);
+                return set;
+
+            case 'b':
+                if (!inClass)
+                    throw std::invalid_argument("Word boundaries are not supported");
+
+                set.set('\b');
+                return set;
+
+            case 'x': {
+                uint8_t value = 0;
+                for (int i = 0; i < 2; ++i)
+                {
+                    const char digit = this->peek();
+                    if (!std::isxdigit(static_cast<unsigned char>(digit)))
+                        throw std::invalid_argument("Invalid hex escape");
+
+                    ++this->mPosition;
+                    value = static_cast<uint8_t>(value * 16 + (std::isdigit(static_cast<unsigned char>(digit))
+                        ? digit - '0' : std::tolower(static_cast<unsigned char>(digit)) - 'a' + 10));
+                };
+
+                set.set(value);
+                return set;
+            };
+
+            default:
+                if (std::isalnum(static_cast<unsigned char>(character)))
+                    throw std::invalid_argument("Unsupported escape");
+
+                set.set(static_cast<uint8_t>(character));
+                return set;
+        };
+
+        // \D, \W and \S are the complement of their lowercase class
+        return std::isupper(static_cast<unsigned char>(character)) ? ~set : set;
+    };
+};
+
+bool RegexSet::add(const std::string_view pattern, const size_t id)
+{
+    const size_t setCount = this->mSets.size();
+    const size_t stateCount = this->mNfa.size();
+
+    try {
+        const RegexNode root = RegexParser{ pattern, this->mSets }.parse();
+
+        this->mNfa.push_back({ NfaState::Match, static_cast<uint32_t>(id) });
+        this->mStarts.push_back(this->emit(root, static_cast<uint32_t>(this->mNfa.size() - 1)));
+    }
+    catch (const std::invalid_argument&) {
+        this->mSets.resize(setCount);
+        this->mNfa.resize(stateCount);
+        return false;
+    };
+
+    this->b_mIsDirty = true;
+    return true;
+};
+
+void RegexSet::compile()
+{
+    if (!this->b_mIsDirty)
+        return;
+
+    this->build();
+    this->b_mIsDirty = false;
+};
+
+std::optional<size_t> RegexSet::match(const std::string_view text) const
+{
+    if (this->mStarts.empty())
+        return std::nullopt;
+
+    uint32_t result = sNoMatch;
+    if (this->isCompiled())
+    {
+        uint32_t state = this->mStartState;
+        for (const char character : text)
+        {
+            state = this->mTransitions[state * this->mClassCount + this->mClasses[static_cast<uint8_t>(character)]];
+            if (state == 0)
+                return std::nullopt;
+        };
+
+        result = this->mAccepts[state];
+    }
+    else
+        result = this->simulate(text);
+
+    if (result == sNoMatch)
+        return std::nullopt;
+
+    return result;
+};
+
+// Thompson construction back to front, every fragment is emitted already wired to what follows it
+uint32_t RegexSet::emit(const RegexNode& node, uint32_t next)
+{
+    if (this->mNfa.size() > sMaxNfaStates)
+        throw std::invalid_argument("Pattern is too large");
+
+    const auto& split = [this](const uint32_t out, const uint32_t out1) {
+        this->mNfa.push_back({ NfaState::Split, 0, out, out1 });
+        return static_cast<uint32_t>(this->mNfa.size() - 1);
+    };
+
+    switch (node.kind)
+    {
+        case RegexNode::Set:
+            this->mNfa.push_back({ NfaState::Set, node.set, next });
+            return static_cast<uint32_t>(this->mNfa.size() - 1);
+
+        case RegexNode::Concat:
+            for (auto child = node.children.rbegin(); child != node.children.rend(); ++child)
+                next = this->emit(*child, next);
+
+            return next;
+
+        case RegexNode::Alternate: {
+            uint32_t start = this->emit(node.children.back(), next);
+            for (size_t i = node.children.size() - 1; i-- > 0;)
+                start = split(this->emit(node.children[i], next), start);
+
+            return start;
+        };
+
+        case RegexNode::Repeat: {
+            const RegexNode& child = node.children.front();
+            uint32_t start = next;
+
+            if (node.max == RegexNode::sUnbounded)
+            {
+                const uint32_t loop = split(0, next);
+                this->mNfa[loop].out = this->emit(child, loop);
+                start = loop;
+            }
+            else
+            {
+                for (uint32_t i = node.min; i < node.max; ++i)
+                    start = split(this->emit(child, start), next);
+            };
+
+            for (uint32_t i = 0; i < node.min; ++i)
+                start = this->emit(child, start);
+
+            return start;
+        };
+    };
+
+    return next;
+};
+
+void RegexSet::build()
+{
+    // Split the bytes into classes every set either fully contains or excludes
+    std::array<uint16_t, 256> classes{};
+    size_t classCount = 1;
+    for (const auto& set : this->mSets)
+    {
+        std::map<std::pair<uint16_t, bool>, uint16_t> refined;
+        for (unsigned value = 0; value < 256; ++value)
+            classes[value] = refined.try_emplace({ classes[value], set.test(value) }, static_cast<uint16_t>(refined.size())).first->second;
+
+        classCount = refined.size();
+    };
+
+    std::vector<uint8_t> representatives(classCount);
+    for (unsigned value = 0; value < 256; ++value)
+    {
+        this->mClasses[value] = static_cast<uint8_t>(classes[value]);
+        representatives[classes[value]] = static_cast<uint8_t>(value);
+    };
+
+    this->mClassCount = classCount;
+
+    // Subset construction, state 0 is the dead state
+    std::map<std::vector<uint32_t>, uint32_t> ids{ { {}, 0 } };
+    std::vector<std::vector<uint32_t>> states{ {} };
+    // Closures mark the NFA states they reach with their own generation
+    std::vector<uint32_t> marks(this->mNfa.size(), 0);
+    uint32_t generation = 1;
+
+    const auto& intern = [&](std::vector<uint32_t> set) {
+        std::ranges::sort(set);
+        const auto& [it, inserted] = ids.try_emplace(set, static_cast<uint32_t>(states.size()));
+        if (inserted)
+            states.push_back(std::move(set));
+
+        return it->second;
+    };
+
+    std::vector<uint32_t> start;
+    for (const uint32_t state : this->mStarts)
+        this->closure(state, start, marks, generation);
+
+    this->mStartState = intern(std::move(start));
+
+    this->mTransitions.assign(classCount, 0);
+    this->mAccepts.assign(1, sNoMatch);
+    for (size_t current = 1; current < states.size(); ++current)
+    {
+        if (states.size() > sMaxDfaStates)
+        {
+            this->b_mHasDfa = false;
+            this->mTransitions.clear();
+            this->mAccepts.clear();
+            return;
+        };
+
+        this->mTransitions.resize((current + 1) * classCount, 0);
+        this->mAccepts.push_back(this->accept(states[current]));
+
+        for (size_t byteClass = 0; byteClass < classCount; ++byteClass)
+        {
+            const uint8_t value = representatives[byteClass];
+
+            std::vector<uint32_t> next;
+            ++generation;
+            for (const uint32_t state : states[current])
+            {
+                if (const NfaState& nfa = this->mNfa[state];
+                    nfa.kind == NfaState::Set && this->mSets[nfa.value].test(value))
+                    this->closure(nfa.out, next, marks, generation);
+            };
+
+            this->mTransitions[current * classCount + byteClass] = intern(std::move(next));
+        };
+    };
+
+    this->b_mHasDfa = true;
+};
+
+void RegexSet::closure(const uint32_t state, std::vector<uint32_t>& states, std::vector<uint32_t>& marks, const uint32_t generation) const
+{
+    std::vector<uint32_t> pending{ state };
+    while (!pending.empty())
+    {
+        const uint32_t current = pending.back();
+        pending.pop_back();
+
+        if (marks[current] == generation)
+            continue;
+
+        marks[current] = generation;
+        if (const NfaState& nfa = this->mNfa[current];
+            nfa.kind == NfaState::Split)
+        {
+            pending.push_back(nfa.out1);
+            pending.push_back(nfa.out);
+        }
+        else
+            states.push_back(current);
+    };
+};
+
+uint32_t RegexSet::accept(const std::vector<uint32_t>& states) const
+{
+    uint32_t result = sNoMatch;
+    for (const uint32_t state : states)
+    {
+        if (const NfaState& nfa = this->mNfa[state];
+            nfa.kind == NfaState::Match)
+            result = std::min(result, nfa.value);
+    };
+
+    return result;
+};
+
+uint32_t RegexSet::simulate(const std::string_view text) const
+{
+    std::vector<uint32_t> marks(this->mNfa.size(), 0);
+    uint32_t generation = 1;
+
+    std::vector<uint32_t> current;
+    for (const uint32_t state : this->mStarts)
+        this->closure(state, current, marks, generation);
+
+    std::vector<uint32_t> next;
+    for (const char character : text)
+    {
+        ++generation;
+        next.clear();
+
+        for (const uint32_t state : current)
+        {
+            if (const NfaState& nfa = this->mNfa[state];
+                nfa.kind == NfaState::Set && this->mSets[nfa.value].test(static_cast<uint8_t>(character)))
+                this->closure(nfa.out, next, marks, generation);
+        };
+
+        if (next.empty())
+            return sNoMatch;
+
+        std::swap(current, next);
+    };
+
+    return this->accept(current);
+};
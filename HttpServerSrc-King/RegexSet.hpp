@@ -0,0 +1,69 @@
+#ifndef REGEXSET_HPP
+#define REGEXSET_HPP
+
+#include <array>
+#include <bitset>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+struct RegexNode;
+
+// Any number of ECMAScript patterns compiled into a single automaton, one pass
+// over the input tells which of them (the lowest id) matches all of it.
+// Literals, ., classes, escapes, groups, alternation and quantifiers are
+// supported, add() refuses anything else (lookarounds, backreferences, ...).
+// The DFA is built by compile() once every pattern is in, until then (or when
+// it would take too many states) the NFA is simulated instead
+class RegexSet
+{
+private:
+    static constexpr size_t sMaxNfaStates = 65536;
+    static constexpr size_t sMaxDfaStates = 4096;
+    static constexpr uint32_t sNoMatch = std::numeric_limits<uint32_t>::max();
+
+    struct NfaState {
+        enum Kind : uint8_t { Set, Split, Match };
+
+        Kind kind{ Set };
+        // Index into mSets for Set, the pattern id for Match
+        uint32_t value{ 0 };
+        uint32_t out{ 0 };
+        uint32_t out1{ 0 };
+    };
+
+    std::vector<std::bitset<256>> mSets{};
+    std::vector<NfaState> mNfa{};
+    std::vector<uint32_t> mStarts{};
+
+    // Bytes no pattern tells apart share a class, DFA transitions are indexed by it
+    std::array<uint8_t, 256> mClasses{};
+    size_t mClassCount{ 0 };
+    uint32_t mStartState{ 0 };
+    std::vector<uint32_t> mTransitions{};
+    std::vector<uint32_t> mAccepts{};
+    bool b_mHasDfa{ false };
+    // Patterns were added since the DFA was built
+    bool b_mIsDirty{ false };
+
+public:
+    bool add(std::string_view pattern, size_t id);
+    // Builds the DFA for everything added so far, not thread-safe against match()
+    void compile();
+    [[nodiscard]] std::optional<size_t> match(std::string_view text) const;
+    [[nodiscard]] bool empty() const { return this->mStarts.empty(); };
+    // Whether match() runs the DFA, false before compile() or past sMaxDfaStates
+    [[nodiscard]] bool isCompiled() const { return this->b_mHasDfa && !this->b_mIsDirty; };
+
+private:
+    uint32_t emit(const RegexNode& node, uint32_t next);
+    void build();
+    void closure(uint32_t state, std::vector<uint32_t>& states, std::vector<uint32_t>& marks, uint32_t generation) const;
+    [[nodiscard]] uint32_t accept(const std::vector<uint32_t>& states) const;
+    [[nodiscard]] uint32_t simulate(std::string_view text) const;
+};
+
+#endif //REGEXSET_HPP
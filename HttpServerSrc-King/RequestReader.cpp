@@ -0,0 +1,288 @@
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+
+#include "RequestReader.hpp"
+#include "util/HeaderName.hpp"
+#include "util/HttpScanner.hpp"
+
+inline bool equalsIgnoreCase(const std::string_view a, const std::string_view b)
+{
+    return std::ranges::equal(a, b, [](const unsigned char x, const unsigned char y) {
+        return std::tolower(x) == std::tolower(y);
+    });
+};
+
+inline std::string_view trim(std::string_view value)
+{
+    while (!value.empty() && (value.front() == ' ' || value.front() == '\t'))
+        value.remove_prefix(1);
+
+    while (!value.empty() && (value.back() == ' ' || value.back() == '\t'))
+        value.remove_suffix(1);
+
+    return value;
+};
+
+RequestReader::Status RequestReader::read(std::string& buffer)
+{
+    if (this->mStatus != Status::Incomplete)
+        return this->mStatus;
+
+    if (this->mState == State::Headers)
+    {
+        if (const Status status = this->readHeaders(buffer);
+            status != Status::Complete)
+            return status;
+    };
+
+    if (this->mState == State::Body)
+    {
+        if (buffer.size() - this->mHeadersEnd < this->mContentLength)
+            return Status::Incomplete;
+
+        this->mBodyEnd = this->mCursor = this->mHeadersEnd + this->mContentLength;
+        this->mState = State::Done;
+    };
+
+    if (this->mState != State::Done)
+    {
+        if (const Status status = this->readChunks(buffer);
+            status != Status::Complete)
+            return status;
+    };
+
+    return this->mStatus = Status::Complete;
+};
+
+RequestReader::Status RequestReader::readHeaders(std::string& buffer)
+{
+    const std::string_view data{ buffer };
+
+    // Lines already scanned are complete, resume from the start of the last one
+    size_t lineStart = std::max(this->mStart, this->mCursor);
+    while (true)
+    {
+        const size_t lineEnd = HttpScanner::findLineEnd(data, lineStart);
+        if (lineEnd == std::string_view::npos || lineEnd + 1 == data.size())
+        {
+            if (data.size() - this->mStart > this->mLimits.maxHeaderSize)
+                return this->fail(Status::HeadersTooLarge);
+
+            this->mCursor = lineStart;
+            return Status::Incomplete;
+        };
+
+        // Bare LF, bare CR and other control bytes have no place in a request head
+        if (data[lineEnd] != '\r' || data[lineEnd + 1] != '\n')
+            return this->fail(Status::Invalid);
+
+        const bool isBlank = lineEnd == lineStart && lineStart != this->mStart;
+        lineStart = lineEnd + 2;
+        if (lineStart - this->mStart > this->mLimits.maxHeaderSize)
+            return this->fail(Status::HeadersTooLarge);
+
+        if (isBlank)
+            break;
+    };
+
+    this->mHeadersEnd = lineStart;
+    const size_t end = this->mHeadersEnd - 2;
+
+    bool isChunked = false;
+    bool hasContentLength = false;
+
+    size_t lpos = HttpScanner::findLineEnd(data, this->mStart) + 2;
+    while (lpos < end)
+    {
+        const size_t colon = HttpScanner::findHeaderName(data, lpos);
+        if (data[colon] != ':')
+        {
+            lpos = colon + 2;
+            continue;
+        };
+
+        const size_t rpos = HttpScanner::findLineEnd(data, colon);
+        const std::string_view name = trim(data.substr(lpos, colon - lpos));
+        const std::string_view value = trim(data.substr(colon + 1, rpos - colon - 1));
+        lpos = rpos + 2;
+
+        switch (HeaderName::fromString(name))
+        {
+            case HeaderName::ContentLength: {
+                size_t length = 0;
+                const auto& [ptr, error] = std::from_chars(value.data(), value.data() + value.size(), length);
+                if (error != std::errc{} || ptr != value.data() + value.size()
+                    || (hasContentLength && length != this->mContentLength))
+                    return this->fail(Status::Invalid);
+
+                hasContentLength = true;
+                this->mContentLength = length;
+                break;
+            };
+
+            case HeaderName::TransferEncoding: {
+                // Chunked has to be the final coding for the length to be known
+                const size_t comma = value.rfind(',');
+                if (!equalsIgnoreCase(trim(comma == std::string_view::npos ? value : value.substr(comma + 1)), "chunked"))
+                    return this->fail(Status::Invalid);
+
+                isChunked = true;
+                break;
+            };
+
+            case HeaderName::Expect:
+                this->b_mExpectsContinue = equalsIgnoreCase(value, "100-continue");
+                break;
+
+            default:
+                break;
+        };
+    };
+
+    this->mCursor = this->mBodyEnd = this->mHeadersEnd;
+    if (isChunked)
+    {
+        this->mContentLength = 0;
+        this->mState = State::ChunkSize;
+        return Status::Complete;
+    };
+
+    if (this->mContentLength > this->mLimits.maxBodySize)
+        return this->fail(Status::BodyTooLarge);
+
+    this->mState = State::Body;
+    return Status::Complete;
+};
+
+RequestReader::Status RequestReader::readChunks(std::string& buffer)
+{
+    while (true)
+    {
+        switch (this->mState)
+        {
+            case State::ChunkSize: {
+                const size_t lineEnd = buffer.find("\r\n", this->mCursor);
+                if (lineEnd == std::string::npos)
+                {
+                    if (buffer.size() - this->mCursor > sMaxChunkLineSize)
+                        return this->fail(Status::Invalid);
+
+                    return Status::Incomplete;
+                };
+
+                // Chunk extensions after ';' are ignored
+                const char* first = buffer.data() + this->mCursor;
+                const char* last = buffer.data() + lineEnd;
+
+                size_t size = 0;
+                const auto& [ptr, error] = std::from_chars(first, last, size, 16);
+                if (error != std::errc{} || (ptr != last && *ptr != ';' && *ptr != ' '))
+                    return this->fail(Status::Invalid);
+
+                this->mCursor = lineEnd + 2;
+                if (size == 0)
+                {
+                    this->mState = State::Trailers;
+                    break;
+                };
+
+                if (size > this->mLimits.maxBodySize - this->mContentLength)
+                    return this->fail(Status::BodyTooLarge);
+
+                this->mChunkRemaining = size;
+                this->mState = State::ChunkData;
+                break;
+            };
+
+            case State::ChunkData: {
+                // Decoded bytes never overtake the raw cursor, so moving them down is safe
+                const size_t count = std::min(this->mChunkRemaining, buffer.size() - this->mCursor);
+                if (this->mBodyEnd != this->mCursor)
+                    std::memmove(buffer.data() + this->mBodyEnd, buffer.data() + this->mCursor, count);
+
+                this->mBodyEnd += count;
+                this->mCursor += count;
+                this->mContentLength += count;
+                this->mChunkRemaining -= count;
+
+                if (this->mChunkRemaining > 0)
+                    return Status::Incomplete;
+
+                this->mState = State::ChunkDataEnd;
+                break;
+            };
+
+            case State::ChunkDataEnd: {
+                if (buffer.size() - this->mCursor < 2)
+                    return Status::Incomplete;
+
+                if (buffer.compare(this->mCursor, 2, "\r\n") != 0)
+                    return this->fail(Status::Invalid);
+
+                this->mCursor += 2;
+                this->mState = State::ChunkSize;
+                break;
+            };
+
+            case State::Trailers: {
+                const size_t lineEnd = buffer.find("\r\n", this->mCursor);
+                if (lineEnd == std::string::npos)
+                {
+                    if (buffer.size() - this->mCursor > this->mLimits.maxHeaderSize)
+                        return this->fail(Status::HeadersTooLarge);
+
+                    return Status::Incomplete;
+                };
+
+                const bool isLastLine = lineEnd == this->mCursor;
+                this->mCursor = lineEnd + 2;
+                if (!isLastLine)
+                    break; // Trailer fields are discarded
+
+                this->mState = State::Done;
+                return Status::Complete;
+            };
+
+            default:
+                return Status::Complete;
+        };
+    };
+};
+
+void RequestReader::reset(const size_t start)
+{
+    this->mState = State::Headers;
+    this->mStatus = Status::Incomplete;
+    this->b_mExpectsContinue = false;
+
+    this->mStart = this->mCursor = start;
+    this->mHeadersEnd = this->mBodyEnd = start;
+    this->mContentLength = this->mChunkRemaining = 0;
+};
+
+void RequestReader::rebase(const size_t consumed)
+{
+    this->mStart -= consumed;
+    this->mCursor -= consumed;
+    this->mHeadersEnd -= std::min(this->mHeadersEnd, consumed);
+    this->mBodyEnd -= std::min(this->mBodyEnd, consumed);
+};
+
+RequestReader::Status RequestReader::fail(const Status status)
+{
+    this->mState = State::Done;
+    return this->mStatus = status;
+};
+
+HttpStatus::Code RequestReader::toHttpStatus(const Status status)
+{
+    switch (status)
+    {
+        case Status::HeadersTooLarge: return HttpStatus::RequestHeaderFieldsTooLarge;
+        case Status::BodyTooLarge:    return HttpStatus::ContentTooLarge;
+        case Status::Invalid:         return HttpStatus::BadRequest;
+
+        default: return HttpStatus::OK;
+    };
+};
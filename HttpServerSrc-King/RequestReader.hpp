@@ -0,0 +1,88 @@
+#ifndef REQUESTREADER_HPP
+#define REQUESTREADER_HPP
+
+#include <string>
+#include <string_view>
+
+#include "util/HttpStatus.hpp"
+
+struct RequestLimits {
+    size_t maxHeaderSize{ 65536 };
+    size_t maxBodySize{ 8 * 1024 * 1024 };
+};
+
+// Resumable HTTP/1.1 request framing, picks up where the previous call
+// stopped each time more bytes are appended to the connection buffer.
+// Chunked bodies are decoded in place so a complete request is always
+// a contiguous header block followed by its body.
+class RequestReader
+{
+public:
+    enum class Status {
+        Incomplete,
+        Complete,
+        Invalid,
+        HeadersTooLarge,
+        BodyTooLarge
+    };
+
+private:
+    enum class State {
+        Headers,
+        Body,
+        ChunkSize,
+        ChunkData,
+        ChunkDataEnd,
+        Trailers,
+        Done
+    };
+
+    static constexpr size_t sMaxChunkLineSize = 1024;
+
+    State mState{ State::Headers };
+    Status mStatus{ Status::Incomplete };
+    bool b_mExpectsContinue{ false };
+
+protected:
+    RequestLimits mLimits{};
+
+    // Absolute offsets into the connection buffer
+    size_t mStart{ 0 };
+    size_t mCursor{ 0 };
+    size_t mHeadersEnd{ 0 };
+    size_t mBodyEnd{ 0 };
+
+    size_t mContentLength{ 0 };
+    size_t mChunkRemaining{ 0 };
+
+public:
+    explicit RequestReader(const RequestLimits& limits = {}) : mLimits(limits) {};
+
+    Status read(std::string& buffer);
+
+    // Starts framing the next request at the given buffer offset
+    void reset(size_t start);
+    // Shifts every offset after the first consumed bytes were erased from the buffer
+    void rebase(size_t consumed);
+
+    [[nodiscard]] Status getStatus() const { return this->mStatus; };
+    [[nodiscard]] bool expectsContinue() const { return this->b_mExpectsContinue && this->mState != State::Done; };
+
+    // Raw bytes the request occupied in the buffer, valid once complete
+    [[nodiscard]] size_t getLength() const { return this->mCursor - this->mStart; };
+    [[nodiscard]] size_t getStart() const { return this->mStart; };
+    [[nodiscard]] size_t getEnd() const { return this->mCursor; };
+    // Header block followed by the decoded body, valid once complete
+    [[nodiscard]] std::string_view getRequest(const std::string& buffer) const {
+        return std::string_view{ buffer }.substr(this->mStart, this->mBodyEnd - this->mStart);
+    };
+
+    static HttpStatus::Code toHttpStatus(Status status);
+
+private:
+    Status readHeaders(std::string& buffer);
+    Status readChunks(std::string& buffer);
+    Status fail(Status status);
+};
+
+#endif //REQUESTREADER_HPP
@@ -0,0 +1,224 @@
+#include <algorithm>
+#include <cctype>
+
+#include "Router.hpp"
+
+size_t Router::add(const std::string& pattern)
+{
+    auto tokens = Router::tokenize(pattern);
+    if (!tokens.has_value())
+    {
+        for (const auto& existing : this->mPatterns)
+        {
+            if (existing.source == pattern)
+                return existing.route;
+        };
+
+        try {
+            // Compiled either way so a pattern std::regex rejects is never routed differently
+            std::regex regex{ pattern };
+            if (this->mRegexSet.add(pattern, this->mRouteCount))
+                this->mPatterns.push_back({ pattern, std::nullopt, this->mRouteCount });
+            else
+                this->mPatterns.push_back({ pattern, std::move(regex), this->mRouteCount });
+
+            return this->mRouteCount++;
+        }
+        catch (const std::regex_error&) {
+            // Not a valid pattern, only the path spelled exactly like it matches
+            tokens = std::vector<Token>{ { Token::Literal, pattern } };
+        };
+    };
+
+    size_t& route = this->insert(tokens.value());
+    if (route == sNone)
+        route = this->mRouteCount++;
+
+    return route;
+};
+
+std::optional<size_t> Router::find(const std::string_view path) const
+{
+    if (const size_t route = this->match(0, path);
+        route != sNone)
+        return route;
+
+    // Patterns are in route order, the ones left to std::regex only matter before the automaton's match
+    const std::optional<size_t> match = this->mRegexSet.match(path);
+    for (const auto& [source, regex, route] : this->mPatterns)
+    {
+        if (match.has_value() && route > match.value())
+            break;
+
+        if (regex.has_value() && std::regex_match(path.begin(), path.end(), regex.value()))
+            return route;
+    };
+
+    return match;
+};
+
+std::optional<std::vector<Router::Token>> Router::tokenize(std::string_view pattern)
+{
+    // regex_match has to match the whole path anyway
+    if (pattern.starts_with('^'))
+        pattern.remove_prefix(1);
+
+    if (pattern.ends_with('$') && !pattern.ends_with("\\$"))
+        pattern.remove_suffix(1);
+
+    std::vector<Token> tokens;
+    std::string literal;
+    const auto& flush = [&]() {
+        if (!literal.empty())
+            tokens.push_back({ Token::Literal, std::move(literal) });
+
+        literal.clear();
+    };
+
+    for (size_t i = 0; i < pattern.size(); ++i)
+    {
+        const char character = pattern[i];
+        const std::string_view rest = pattern.substr(i);
+
+        if (rest == ".*")
+        {
+            flush();
+            tokens.push_back({ Token::Wildcard });
+            return tokens;
+        };
+
+        // Only a whole segment, so it can't match any differently than the regex would
+        if (rest.starts_with("[^/]+") && literal.ends_with('/')
+            && (rest.size() == 5 || rest[5] == '/'))
+        {
+            flush();
+            tokens.push_back({ Token::Parameter });
+            i += 4;
+            continue;
+        };
+
+        if (character == '\\')
+        {
+            if (i + 1 == pattern.size() || std::isalnum(static_cast<unsigned char>(pattern[i + 1])))
+                return std::nullopt;
+
+            literal += pattern[++i];
+            continue;
+        };
+
+        if (std::string_view{ ".^$|?*+()[]{}" }.find(character) != std::string_view::npos)
+            return std::nullopt;
+
+        literal += character;
+    };
+
+    flush();
+    return tokens;
+};
+
+size_t& Router::insert(const std::vector<Token>& tokens)
+{
+    uint32_t node = 0;
+    for (const auto& [kind, text] : tokens)
+    {
+        switch (kind)
+        {
+            case Token::Literal:
+                node = this->insertLiteral(node, text);
+                break;
+
+            case Token::Parameter:
+                if (this->mNodes[node].parameter == 0)
+                {
+                    this->mNodes.emplace_back();
+                    this->mNodes[node].parameter = static_cast<uint32_t>(this->mNodes.size() - 1);
+                };
+
+                node = this->mNodes[node].parameter;
+                break;
+
+            case Token::Wildcard:
+                return this->mNodes[node].wildcard;
+        };
+    };
+
+    return this->mNodes[node].route;
+};
+
+uint32_t Router::insertLiteral(uint32_t node, std::string_view text)
+{
+    while (!text.empty())
+    {
+        const size_t position = this->mNodes[node].indices.find(text.front());
+        if (position == std::string::npos)
+        {
+            Node child{};
+            child.prefix = text;
+            this->mNodes.push_back(std::move(child));
+
+            const auto index = static_cast<uint32_t>(this->mNodes.size() - 1);
+            this->mNodes[node].indices += text.front();
+            this->mNodes[node].children.push_back(index);
+            return index;
+        };
+
+        const uint32_t index = this->mNodes[node].children[position];
+        const std::string& prefix = this->mNodes[index].prefix;
+        const size_t common = std::ranges::mismatch(prefix, text).in1 - prefix.begin();
+
+        // Split the edge, the child keeps the shared part and the rest moves down a level
+        if (common < prefix.size())
+        {
+            Node tail = std::move(this->mNodes[index]);
+            Node& head = this->mNodes[index];
+            head = Node{};
+            head.prefix = tail.prefix.substr(0, common);
+            tail.prefix.erase(0, common);
+            head.indices = tail.prefix.substr(0, 1);
+
+            this->mNodes.push_back(std::move(tail));
+            this->mNodes[index].children.push_back(static_cast<uint32_t>(this->mNodes.size() - 1));
+        };
+
+        text.remove_prefix(common);
+        node = index;
+    };
+
+    return node;
+};
+
+size_t Router::match(const uint32_t node, const std::string_view path) const
+{
+    const Node& current = this->mNodes[node];
+    if (path.empty() && current.route != sNone)
+        return current.route;
+
+    if (!path.empty())
+    {
+        if (const size_t position = current.indices.find(path.front());
+            position != std::string::npos)
+        {
+            const uint32_t child = current.children[position];
+            if (const std::string& prefix = this->mNodes[child].prefix;
+                path.starts_with(prefix))
+            {
+                if (const size_t route = this->match(child, path.substr(prefix.size()));
+                    route != sNone)
+                    return route;
+            };
+        };
+
+        if (current.parameter != 0)
+        {
+            const size_t length = std::min(path.find('/'), path.size());
+            if (length > 0)
+            {
+                if (const size_t route = this->match(current.parameter, path.substr(length));
+                    route != sNone)
+                    return route;
+            };
+        };
+    };
+
+    return current.wildcard;
+};
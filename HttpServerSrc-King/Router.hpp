@@ -0,0 +1,73 @@
+#ifndef ROUTER_HPP
+#define ROUTER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <regex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "RegexSet.hpp"
+
+// Maps request paths to the index of the route they match. Routes are regex
+// patterns, the ones made only of literal text, [^/]+ segments and a
+// trailing .* are compiled into a radix tree when registered (literal text
+// beats a segment, which beats .*). Once the tree has no match the other
+// patterns are tried in registration order, all at once through a RegexSet,
+// apart from the few it can't compile which stay std::regex
+class Router
+{
+private:
+    static constexpr size_t sNone = std::numeric_limits<size_t>::max();
+
+    struct Node {
+        std::string prefix{};
+        // First byte of each literal child, in the same order as children
+        std::string indices{};
+        std::vector<uint32_t> children{};
+        uint32_t parameter{ 0 };
+        size_t route{ sNone };
+        size_t wildcard{ sNone };
+    };
+
+    struct Token {
+        enum Kind { Literal, Parameter, Wildcard };
+
+        Kind kind{ Literal };
+        std::string text{};
+    };
+
+    struct Pattern {
+        std::string source{};
+        // Only set for patterns mRegexSet couldn't take
+        std::optional<std::regex> regex{};
+        size_t route{ sNone };
+    };
+
+    std::vector<Node> mNodes{ 1 };
+    std::vector<Pattern> mPatterns{};
+    RegexSet mRegexSet{};
+    size_t mRouteCount{ 0 };
+
+public:
+    // Index of the route, the same one every time for a pattern that's already registered
+    size_t add(const std::string& pattern);
+    [[nodiscard]] std::optional<size_t> find(std::string_view path) const;
+    [[nodiscard]] size_t size() const { return this->mRouteCount; };
+
+    // Builds the automaton for the regex routes, once they're all registered
+    void compile() { this->mRegexSet.compile(); };
+    // False when the regex routes are matched by simulating the NFA, each pattern adds to every lookup
+    [[nodiscard]] bool isCompiled() const { return this->mRegexSet.empty() || this->mRegexSet.isCompiled(); };
+
+private:
+    static std::optional<std::vector<Token>> tokenize(std::string_view pattern);
+    size_t& insert(const std::vector<Token>& tokens);
+    uint32_t insertLiteral(uint32_t node, std::string_view text);
+    size_t match(uint32_t node, std::string_view path) const;
+};
+
+#endif //ROUTER_HPP
@@ -0,0 +1,491 @@
+#include <algorithm>
+#include <array>
+#include <fstream>
+#include <optional>
+#include <sstream>
+#include <stdexcept>
+
+#if defined(__unix__) || defined(__APPLE__)
+    #include <fcntl.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+#if defined(__linux__)
+    #include <cerrno>
+    #include <ranges>
+    #include <thread>
+    #include <sys/inotify.h>
+#endif
+
+#include "StaticFileCache.hpp"
+#include "OutputQueue.hpp"
+#include "util/ETag.hpp"
+#include "util/HttpDate.hpp"
+#include "util/MimeType.hpp"
+
+// Size and modification time of a regular file, false when it's missing or something else
+inline bool statFile(const std::filesystem::path& path, size_t& size, std::time_t& modified, long* nanoseconds = nullptr)
+{
+#if defined(__unix__) || defined(__APPLE__)
+    struct stat info{};
+    if (::stat(path.c_str(), &info) != 0 || !S_ISREG(info.st_mode))
+        return false;
+
+    size = static_cast<size_t>(info.st_size);
+    modified = info.st_mtime;
+    if (nanoseconds != nullptr)
+#if defined(__APPLE__)
+        *nanoseconds = info.st_mtimespec.tv_nsec;
+#else
+        *nanoseconds = info.st_mtim.tv_nsec;
+#endif
+
+    return true;
+#else
+    std::error_code error;
+    if (!std::filesystem::is_regular_file(path, error))
+        return false;
+
+    size = static_cast<size_t>(std::filesystem::file_size(path, error));
+    const auto& time = std::filesystem::last_write_time(path, error);
+    modified = std::chrono::system_clock::to_time_t(std::chrono::clock_cast<std::chrono::system_clock>(time));
+    if (nanoseconds != nullptr)
+        *nanoseconds = static_cast<long>(time.time_since_epoch().count() % 1000000000);
+
+    return !error;
+#endif
+};
+
+// Whether path is changed itself or lies somewhere below it
+inline bool isWithin(const std::filesystem::path& path, const std::filesystem::path& changed)
+{
+    const auto& [end, _] = std::mismatch(changed.begin(), changed.end(), path.begin(), path.end());
+    return end == changed.end();
+};
+
+#if defined(__linux__)
+// One inotify instance and thread for every cache in the process. Directories
+// are watched once however many caches serve files from them, and a change is
+// passed on to each of those caches
+class StaticFileWatcher
+{
+private:
+    struct Watch {
+        std::filesystem::path directory{};
+        std::vector<StaticFileCache*> caches{};
+    };
+
+    int mInotifyFd{ -1 };
+    // Watched directories by watch descriptor and the other way around
+    std::unordered_map<int, Watch> mWatches{};
+    std::unordered_map<std::string, int> mWatchedPaths{};
+    // Held while a change is passed on, so a cache that forgot its watches gets no more calls
+    std::mutex mMutex{};
+
+public:
+    // Never destroyed, a cache may still be alive while statics are torn down
+    static StaticFileWatcher& get() {
+        static auto* watcher = new StaticFileWatcher();
+        return *watcher;
+    };
+
+    void watch(const std::filesystem::path& directory, StaticFileCache* cache) {
+        std::lock_guard lock(this->mMutex);
+        if (const auto& it = this->mWatchedPaths.find(directory.native()); it != this->mWatchedPaths.end())
+        {
+            auto& caches = this->mWatches[it->second].caches;
+            if (std::ranges::find(caches, cache) == caches.end())
+                caches.push_back(cache);
+
+            return;
+        };
+
+        constexpr uint32_t mask = IN_MODIFY | IN_ATTRIB | IN_CLOSE_WRITE | IN_CREATE | IN_DELETE
+            | IN_MOVED_FROM | IN_MOVED_TO | IN_DELETE_SELF | IN_MOVE_SELF | IN_ONLYDIR;
+
+        const int descriptor = inotify_add_watch(this->mInotifyFd, directory.c_str(), mask);
+        if (descriptor < 0)
+            return;
+
+        this->mWatches[descriptor] = { directory, { cache } };
+        this->mWatchedPaths[directory.native()] = descriptor;
+    };
+
+    // Called by a cache that goes away, directories nothing else is cached from are no longer watched
+    void forget(StaticFileCache* cache) {
+        std::lock_guard lock(this->mMutex);
+        for (auto it = this->mWatches.begin(); it != this->mWatches.end();)
+        {
+            std::erase(it->second.caches, cache);
+            if (!it->second.caches.empty())
+            {
+                ++it;
+                continue;
+            };
+
+            inotify_rm_watch(this->mInotifyFd, it->first);
+            this->mWatchedPaths.erase(it->second.directory.native());
+            it = this->mWatches.erase(it);
+        };
+    };
+
+private:
+    StaticFileWatcher() {
+        this->mInotifyFd = inotify_init1(IN_CLOEXEC);
+        if (this->mInotifyFd < 0)
+            throw std::runtime_error("Failed to create inotify instance");
+
+        std::thread(&StaticFileWatcher::run, this).detach();
+    };
+
+    void run() {
+        alignas(inotify_event) std::array<char, 16384> buffer{};
+        while (true)
+        {
+            const ssize_t length = read(this->mInotifyFd, buffer.data(), buffer.size());
+            if (length <= 0)
+            {
+                if (length < 0 && errno == EINTR)
+                    continue;
+
+                return;
+            };
+
+            std::lock_guard lock(this->mMutex);
+            for (ssize_t offset = 0; offset < length;)
+            {
+                const auto* event = reinterpret_cast<const inotify_event*>(buffer.data() + offset);
+                offset += static_cast<ssize_t>(sizeof(inotify_event) + event->len);
+
+                // Events were dropped, nothing cached can be trusted anymore
+                if (event->mask & IN_Q_OVERFLOW)
+                {
+                    std::vector<StaticFileCache*> caches;
+                    for (const auto& watch : this->mWatches | std::views::values)
+                    {
+                        for (StaticFileCache* cache : watch.caches)
+                        {
+                            if (std::ranges::find(caches, cache) == caches.end())
+                                caches.push_back(cache);
+                        };
+                    };
+
+                    for (StaticFileCache* cache : caches)
+                        cache->invalidate(cache->mRoot.root_path());
+
+                    continue;
+                };
+
+                const auto& it = this->mWatches.find(event->wd);
+                if (it == this->mWatches.end())
+                    continue;
+
+                const std::filesystem::path& directory = it->second.directory;
+                const auto& changed = event->len > 0 ? directory / event->name : directory;
+                for (StaticFileCache* cache : it->second.caches)
+                    cache->invalidate(changed);
+
+                // The directory itself is gone or elsewhere, its watch is of no use anymore
+                if (event->mask & (IN_DELETE_SELF | IN_MOVE_SELF | IN_IGNORED))
+                {
+                    inotify_rm_watch(this->mInotifyFd, event->wd);
+                    this->mWatchedPaths.erase(directory.native());
+                    this->mWatches.erase(it);
+                };
+            };
+        };
+    };
+};
+#endif
+
+StaticFileCache::StaticFileCache(std::filesystem::path root, const StaticCacheLimits& limits)
+    : mRoot(std::move(root)), mLimits(limits)
+{
+};
+
+StaticFileCache::~StaticFileCache()
+{
+#if defined(__linux__)
+    if (this->isEnabled())
+        StaticFileWatcher::get().forget(this);
+#endif
+};
+
+std::shared_ptr<const StaticFile> StaticFileCache::find(const std::string& key)
+{
+    std::shared_ptr<const StaticFile> file;
+    {
+        std::lock_guard lock(this->mMutex);
+        const auto& it = this->mIndex.find(key);
+        if (it == this->mIndex.end())
+            return nullptr;
+
+        this->mEntries.splice(this->mEntries.begin(), this->mEntries, it->second);
+        file = it->second->file;
+    };
+
+#if !defined(__linux__)
+    // Without change notifications a hit only counts while the file still looks the same
+    size_t size = 0;
+    std::time_t modified = 0;
+    if (!statFile(file->path, size, modified) || size != file->size || modified != file->modified)
+    {
+        this->invalidate(file->path);
+        return nullptr;
+    };
+#endif
+
+    return file;
+};
+
+std::shared_ptr<const StaticFile> StaticFileCache::load(const std::string& key,
+    const std::filesystem::path& path, const std::filesystem::path& requestedPath)
+{
+    if (!this->isEnabled())
+        return nullptr;
+
+    const uint64_t generation = this->mGeneration.load();
+
+#if defined(__linux__)
+    // Watched before reading, so a change made while it's read still invalidates it
+    for (auto directory = path.parent_path(); isWithin(directory, this->mRoot); directory = directory.parent_path())
+    {
+        StaticFileWatcher::get().watch(directory, this);
+        if (directory == this->mRoot || !directory.has_relative_path())
+            break;
+    };
+
+    StaticFileWatcher::get().watch(requestedPath.parent_path(), this);
+#endif
+
+    auto file = std::make_shared<StaticFile>();
+    long nanoseconds = 0;
+    if (!statFile(path, file->size, file->modified, &nanoseconds))
+        return nullptr;
+
+    if (file->size <= this->mLimits.maxFileSize)
+    {
+        file->contents = this->readFile(path);
+        if (!file->contents)
+            return nullptr;
+
+        file->size = file->contents->size();
+    };
+
+    // Hashed once per version of the file, a file that's streamed goes by its version alone
+    file->etag = file->contents ? ETag::fromContents(*file->contents)
+        : ETag::fromMetadata(file->size, file->modified, nanoseconds);
+    file->lastModified = HttpDate::toString(file->modified);
+    file->contentType = MimeType::getMimeType(path);
+    file->path = path;
+    file->requestedPath = requestedPath;
+
+    for (const auto& [encoding, extension] : sSidecars)
+    {
+        std::filesystem::path sidecar = path;
+        sidecar += extension;
+
+        size_t size = 0;
+        std::time_t modified = 0;
+        if (statFile(sidecar, size, modified))
+            file->sidecars[encoding] = std::move(sidecar);
+    };
+
+    // Streamed files are compressed by sendFile itself, if at all
+    const bool compressible = file->contents && file->size >= Compression::MIN_SIZE
+        && MimeType::isCompressible(file->contentType);
+
+    for (const auto encoding : { Compression::Brotli, Compression::Gzip, Compression::Deflate })
+    {
+        if (!file->sidecars[encoding].empty()
+            || (compressible && std::ranges::find(Compression::COMPRESSORS, encoding) != std::end(Compression::COMPRESSORS)))
+            file->encodings.push_back(encoding);
+    };
+
+    if (this->mGeneration.load() == generation)
+        this->insert(key, file);
+
+    return file;
+};
+
+bool StaticFileCache::serve(HttpResponse& response, const std::string& key, const std::shared_ptr<const StaticFile>& file)
+{
+    response.setHeader("Content-Type", file->contentType);
+    response.setHeader("ETag", file->etag);
+    response.setHeader("Last-Modified", file->lastModified);
+
+    Compression::Encoding encoding = response.negotiateEncoding(file->encodings);
+    auto body = this->encode(key, file, encoding);
+    if (encoding != Compression::Identity)
+    {
+        // Each encoding is a representation of its own, and needs a tag of its own
+        const std::string& name = Compression::toString(encoding);
+        response.setHeader("Content-Encoding", name);
+        response.setHeader("ETag", ETag::withEncoding(file->etag, name));
+    };
+
+    if (body)
+        return response.sendNotModified() || response.send(std::move(body));
+
+    // A sidecar is sent as the type of the file it was compressed from
+    return response.sendFile(encoding == Compression::Identity ? file->path : file->sidecars[encoding], file->contentType);
+};
+
+void StaticFileCache::insert(const std::string& key, std::shared_ptr<const StaticFile> file)
+{
+    const size_t size = (file->contents ? file->contents->size() : 0) + sEntryOverhead;
+    if (size > this->mLimits.maxMemory)
+        return;
+
+    std::lock_guard lock(this->mMutex);
+    if (const auto& it = this->mIndex.find(key); it != this->mIndex.end())
+        this->erase(it->second);
+
+    while (!this->mEntries.empty() && this->mMemory + size > this->mLimits.maxMemory)
+        this->erase(std::prev(this->mEntries.end()));
+
+    this->mEntries.push_front({ key, std::move(file), {}, size });
+    this->mIndex[key] = this->mEntries.begin();
+    this->mMemory += size;
+};
+
+std::shared_ptr<const std::string> StaticFileCache::encode(const std::string& key,
+    const std::shared_ptr<const StaticFile>& file, Compression::Encoding& encoding)
+{
+    if (encoding == Compression::Identity)
+        return file->contents;
+
+    // Only while the entry is still this very file, it may have been replaced meanwhile
+    const auto& findEntry = [this, &key, &file]() -> std::optional<std::list<Entry>::iterator> {
+        const auto& it = this->mIndex.find(key);
+        if (it == this->mIndex.end() || it->second->file != file)
+            return std::nullopt;
+
+        return it->second;
+    };
+
+    {
+        std::lock_guard lock(this->mMutex);
+        if (const auto& entry = findEntry();
+            entry.has_value() && entry.value()->encoded[encoding])
+        {
+            if (entry.value()->encoded[encoding] == file->contents)
+                encoding = Compression::Identity;
+
+            return entry.value()->encoded[encoding];
+        };
+    };
+
+    std::shared_ptr<const std::string> encoded = file->contents;
+    if (!file->sidecars[encoding].empty())
+    {
+        encoded = this->readFile(file->sidecars[encoding]);
+        if (!encoded)
+            return nullptr;
+    }
+    else if (auto compressed = Compression::compress(*file->contents, encoding);
+        compressed.has_value() && compressed->size() < file->contents->size())
+        encoded = std::make_shared<const std::string>(std::move(compressed.value()));
+
+    const Compression::Encoding requested = encoding;
+    if (encoded == file->contents)
+        encoding = Compression::Identity;
+
+    std::lock_guard lock(this->mMutex);
+    const auto& entry = findEntry();
+    if (!entry.has_value() || entry.value()->encoded[requested])
+        return encoded;
+
+    entry.value()->encoded[requested] = encoded;
+    if (encoded != file->contents)
+    {
+        entry.value()->memory += encoded->size();
+        this->mMemory += encoded->size();
+    };
+
+    while (this->mMemory > this->mLimits.maxMemory && std::prev(this->mEntries.end()) != entry.value())
+        this->erase(std::prev(this->mEntries.end()));
+
+    return encoded;
+};
+
+std::shared_ptr<const std::string> StaticFileCache::readFile(const std::filesystem::path& path) const
+{
+    std::string contents;
+
+#if defined(__unix__) || defined(__APPLE__)
+    const int descriptor = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (descriptor < 0)
+        return nullptr;
+
+    const FileHandle handle{ descriptor };
+    struct stat info{};
+    if (fstat(descriptor, &info) != 0 || !S_ISREG(info.st_mode)
+        || static_cast<size_t>(info.st_size) > this->mLimits.maxFileSize)
+        return nullptr;
+
+    contents.resize_and_overwrite(info.st_size, [descriptor](char* data, const size_t size) {
+        size_t total = 0;
+        while (total < size)
+        {
+            const ssize_t bytesRead = pread(descriptor, data + total, size - total, static_cast<off_t>(total));
+            if (bytesRead <= 0)
+                break;
+
+            total += static_cast<size_t>(bytesRead);
+        };
+
+        return total;
+    });
+
+    // Shrunk while it was read
+    if (contents.size() != static_cast<size_t>(info.st_size))
+        return nullptr;
+#else
+    size_t size = 0;
+    std::time_t modified = 0;
+    if (!statFile(path, size, modified) || size > this->mLimits.maxFileSize)
+        return nullptr;
+
+    std::ifstream stream(path, std::ios::binary);
+    if (!stream)
+        return nullptr;
+
+    std::ostringstream buffer;
+    buffer << stream.rdbuf();
+    contents = buffer.str();
+#endif
+
+    return std::make_shared<const std::string>(std::move(contents));
+};
+
+void StaticFileCache::erase(const std::list<Entry>::iterator entry)
+{
+    this->mMemory -= entry->memory;
+    this->mIndex.erase(entry->key);
+    this->mEntries.erase(entry);
+};
+
+void StaticFileCache::invalidate(const std::filesystem::path& path)
+{
+    // A precompressed sibling that changed, appeared or went away changes the file it belongs to
+    std::filesystem::path owner;
+    for (const auto& [encoding, extension] : sSidecars)
+    {
+        if (path.extension() == extension)
+            owner = path.parent_path() / path.stem();
+    };
+
+    std::lock_guard lock(this->mMutex);
+    ++this->mGeneration;
+
+    for (auto it = this->mEntries.begin(); it != this->mEntries.end();)
+    {
+        const auto current = it++;
+        const StaticFile& file = *current->file;
+        if (isWithin(file.path, path) || isWithin(file.requestedPath, path)
+            || (!owner.empty() && (file.path == owner || file.requestedPath == owner)))
+            this->erase(current);
+    };
+};
@@ -0,0 +1,107 @@
+#ifndef STATICFILECACHE_HPP
+#define STATICFILECACHE_HPP
+
+#include <array>
+#include <atomic>
+#include <ctime>
+#include <filesystem>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "HttpResponse.hpp"
+#include "util/Compression.hpp"
+
+struct StaticCacheLimits {
+    // Total bytes of file contents kept in memory, 0 turns the cache off
+    size_t maxMemory{ 64 * 1024 * 1024 };
+    // Larger files are always streamed from disk, only what's needed to serve them is kept
+    size_t maxFileSize{ 1024 * 1024 };
+};
+
+struct StaticFile {
+    // Nothing when the file is streamed from disk instead
+    std::shared_ptr<const std::string> contents{};
+    size_t size{ 0 };
+    std::string contentType{};
+    std::string etag{};
+    std::string lastModified{};
+    std::time_t modified{ 0 };
+    // Where it was read from, and the path it was requested as
+    std::filesystem::path path{};
+    std::filesystem::path requestedPath{};
+    // Precompressed siblings next to it (app.js.br, app.js.gz) by encoding, empty for the missing ones
+    std::array<std::filesystem::path, Compression::Brotli + 1> sidecars{};
+    // Every encoding it can be sent with, best first
+    std::vector<Compression::Encoding> encodings{};
+};
+
+// Least recently used file contents of a static directory with the headers
+// they're served with, keyed by request path so a hit touches no filesystem.
+// Compressed variants, precompressed siblings included, are cached along with them.
+// On Linux entries are dropped through inotify as soon as their file (or a
+// directory above it) changes, one watcher thread serves every cache in the
+// process. Elsewhere a hit checks the file's size and mtime
+class StaticFileCache
+{
+#if defined(__linux__)
+    friend class StaticFileWatcher;
+#endif
+
+private:
+    // What an entry costs besides its contents, so streamed files count as well
+    static constexpr size_t sEntryOverhead = 512;
+    static constexpr std::pair<Compression::Encoding, const char*> sSidecars[] = {
+        { Compression::Brotli, ".br" },
+        { Compression::Gzip, ".gz" }
+    };
+
+    struct Entry {
+        std::string key{};
+        std::shared_ptr<const StaticFile> file{};
+        // Compressed contents by encoding, the contents themselves when compressing didn't pay off
+        std::array<std::shared_ptr<const std::string>, Compression::Brotli + 1> encoded{};
+        size_t memory{ 0 };
+    };
+
+    std::filesystem::path mRoot{};
+    StaticCacheLimits mLimits{};
+    std::list<Entry> mEntries{};
+    std::unordered_map<std::string, std::list<Entry>::iterator> mIndex{};
+    size_t mMemory{ 0 };
+    // Bumped by every invalidation, a file read while it changed isn't cached
+    std::atomic<uint64_t> mGeneration{ 0 };
+    std::mutex mMutex{};
+
+public:
+    explicit StaticFileCache(std::filesystem::path root, const StaticCacheLimits& limits = {});
+    ~StaticFileCache();
+
+    StaticFileCache(const StaticFileCache&) = delete;
+    StaticFileCache& operator=(const StaticFileCache&) = delete;
+
+    [[nodiscard]] bool isEnabled() const { return this->mLimits.maxMemory > 0; };
+
+    std::shared_ptr<const StaticFile> find(const std::string& key);
+    // Reads a file that was checked to be servable (only its details when it's too large) and caches it.
+    // Nothing when it can't be read
+    std::shared_ptr<const StaticFile> load(const std::string& key,
+        const std::filesystem::path& path, const std::filesystem::path& requestedPath);
+    // Sends the file with its headers, in the best encoding the client accepts
+    bool serve(HttpResponse& response, const std::string& key, const std::shared_ptr<const StaticFile>& file);
+
+private:
+    void insert(const std::string& key, std::shared_ptr<const StaticFile> file);
+    // The contents in an encoding, compressed or read once for as long as the file stays cached.
+    // Nothing when it's streamed from disk, encoding is Identity after compressing didn't pay off
+    std::shared_ptr<const std::string> encode(const std::string& key,
+        const std::shared_ptr<const StaticFile>& file, Compression::Encoding& encoding);
+    std::shared_ptr<const std::string> readFile(const std::filesystem::path& path) const;
+    void erase(std::list<Entry>::iterator entry);
+    void invalidate(const std::filesystem::path& path);
+};
+
+#endif //STATICFILECACHE_HPP
@@ -2,8 +2,9 @@
 
 #include "HttpServer.hpp"
 
-void WebSocket::sendFrame(const uint8_t opcode, std::span<const uint8_t> data) const {
+std::string WebSocket::encodeFrame(const uint8_t opcode, const std::span<const uint8_t> data) {
     std::string frame;
+    frame.reserve(10 + data.size());
     frame.push_back(static_cast<char>(0x80 | opcode));
 
     const size_t payloadSize = data.size();
@@ -22,10 +23,14 @@ void WebSocket::sendFrame(const uint8_t opcode, std::span<const uint8_t> data) c
     };
 
     frame.append(reinterpret_cast<const char*>(data.data()), data.size());
-    HttpServer::sendToSocket(this->mClientSocket, frame);
+    return frame;
 };
 
-void WebSocket::send(const std::string& text) const {
+void WebSocket::sendFrame(const uint8_t opcode, const std::span<const uint8_t> data) const {
+    this->mOutbox->push(std::make_shared<const std::string>(WebSocket::encodeFrame(opcode, data)));
+};
+
+void WebSocket::send(const std::string_view text) const {
     this->sendFrame(0x1, std::span(
         reinterpret_cast<const uint8_t*>(text.data()), text.size()
     ));
@@ -40,9 +45,10 @@ void WebSocket::send(const std::span<const uint8_t> binary) const {
 };
 
 void WebSocket::closeSocket() const {
+    // The connection owns the descriptor, shutting it down ends the read loop
 #if defined(_WIN32)
-    ::closesocket(this->mClientSocket);
+    ::shutdown(this->mClientSocket, SD_BOTH);
 #elif defined(__unix__) || defined(__APPLE__)
-    ::close(this->mClientSocket);
+    ::shutdown(this->mClientSocket, SHUT_RDWR);
 #endif
 };
\ No newline at end of file
@@ -1,29 +1,44 @@
 #ifndef WEBSOCKET_HPP
 #define WEBSOCKET_HPP
 
+#include <memory>
 #include <span>
 #include <string>
+#include <string_view>
 #include <variant>
 
 #include "Common.hpp"
 #include "HttpRequest.hpp"
+#include "WebSocketOutbox.hpp"
+#include "WebSocketReader.hpp"
 
 class WebSocket {
+    friend class HttpServer;
+    friend class WebSocketHub;
+    friend struct WebSocketSession;
+
 protected:
     Socket_t mClientSocket{ 0 };
-    HttpRequest mHttpRequest{ 0, "" };
+    // The upgrade request, shared by every copy of the socket
+    std::shared_ptr<const HttpRequest> mHttpRequest{};
+    // Every frame sent to the socket goes through it, broadcasts included
+    std::shared_ptr<WebSocketOutbox> mOutbox{};
 
 public:
-    explicit WebSocket(const Socket_t clientSocket, const HttpRequest& httpRequest)
-        : mClientSocket(clientSocket), mHttpRequest(httpRequest) {};
+    explicit WebSocket(const Socket_t clientSocket, std::shared_ptr<const HttpRequest> httpRequest)
+        : mClientSocket(clientSocket), mHttpRequest(std::move(httpRequest)),
+          mOutbox(std::make_shared<WebSocketOutbox>(clientSocket)) {};
 
-    [[nodiscard]] const HttpRequest& getHttpRequest() const { return this->mHttpRequest; };
+    [[nodiscard]] const HttpRequest& getHttpRequest() const { return *this->mHttpRequest; };
 
-    void send(const std::string& text) const;
+    void send(std::string_view text) const;
     void send(const std::vector<uint8_t>& binary) const;
     void send(std::span<const uint8_t> binary) const;
     void closeSocket() const;
 
+    // A whole unmasked frame (as a server sends it) with the payload
+    static std::string encodeFrame(uint8_t opcode, std::span<const uint8_t> data);
+
 private:
     void sendFrame(uint8_t opcode, std::span<const uint8_t> data) const;
 };
@@ -37,10 +52,32 @@ struct WebSocketHandler {
         };
     std::function<void(WebSocket&)> onOpen = [] (WebSocket&) {};
 
-    std::function<void(WebSocket&, const std::string&)> onText = [] (WebSocket&, const std::string&) {};
+    // Messages point into the connection's buffer, they're only valid during the call
+    std::function<void(WebSocket&, std::string_view)> onText = [] (WebSocket&, std::string_view) {};
     std::function<void(WebSocket&, std::span<const uint8_t>)> onBinary = [] (WebSocket&, std::span<const uint8_t>) {};
 
     std::function<void(WebSocket&)> onClose = [] (WebSocket&) {};
 };
 
+// What an upgraded connection keeps for as long as it's open. The event loop
+// reads its frames and only hands it to a worker once a message completes
+struct WebSocketSession {
+    const WebSocketHandler* handler{ nullptr };
+    WebSocket socket;
+    WebSocketReader reader;
+    // The peer went away, onClose is still owed
+    bool isClosed{ false };
+
+    // The upgrade request is copied out of the connection buffer
+    WebSocketSession(const Socket_t clientSocket, const HttpRequest& httpRequest,
+        const WebSocketHandler& webSocketHandler, const WebSocketLimits& limits)
+        : handler(&webSocketHandler), socket(clientSocket, std::make_shared<const HttpRequest>(httpRequest)), reader(limits) {};
+
+    // Nothing is written to the socket anymore once the session is gone
+    ~WebSocketSession() { this->socket.mOutbox->close(); };
+
+    WebSocketSession(const WebSocketSession&) = delete;
+    WebSocketSession& operator=(const WebSocketSession&) = delete;
+};
+
 #endif //WEBSOCKET_HPP
@@ -0,0 +1,77 @@
+#include <algorithm>
+
+#include "WebSocketHub.hpp"
+
+void WebSocketHub::subscribe(const std::string& topic, const WebSocket& webSocket)
+{
+    std::unique_lock lock(this->mMutex);
+    auto& subscribers = this->mTopics[topic];
+    if (std::ranges::find(subscribers, webSocket.mOutbox) == subscribers.end())
+        subscribers.push_back(webSocket.mOutbox);
+};
+
+void WebSocketHub::unsubscribe(const std::string& topic, const WebSocket& webSocket)
+{
+    std::unique_lock lock(this->mMutex);
+    const auto& it = this->mTopics.find(topic);
+    if (it == this->mTopics.end())
+        return;
+
+    std::erase(it->second, webSocket.mOutbox);
+    if (it->second.empty())
+        this->mTopics.erase(it);
+};
+
+size_t WebSocketHub::publish(const std::string_view topic, const std::string_view text)
+{
+    return this->publish(topic, std::make_shared<const std::string>(WebSocket::encodeFrame(0x1,
+        std::span{ reinterpret_cast<const uint8_t*>(text.data()), text.size() })));
+};
+
+size_t WebSocketHub::publish(const std::string_view topic, const std::span<const uint8_t> binary)
+{
+    return this->publish(topic, std::make_shared<const std::string>(WebSocket::encodeFrame(0x2, binary)));
+};
+
+size_t WebSocketHub::getSubscriberCount(const std::string_view topic)
+{
+    std::shared_lock lock(this->mMutex);
+    const auto& it = this->mTopics.find(std::string{ topic });
+    return it == this->mTopics.end() ? 0 : it->second.size();
+};
+
+size_t WebSocketHub::publish(const std::string_view topic, const std::shared_ptr<const std::string>& frame)
+{
+    const std::string key{ topic };
+    size_t delivered = 0;
+    size_t closed = 0;
+    {
+        // Publishers only read the topics, they fan out side by side
+        std::shared_lock lock(this->mMutex);
+        const auto& it = this->mTopics.find(key);
+        if (it == this->mTopics.end())
+            return 0;
+
+        for (const auto& outbox : it->second)
+        {
+            if (outbox->push(frame))
+                ++delivered;
+            else
+                ++closed;
+        };
+    };
+
+    if (closed == 0)
+        return delivered;
+
+    std::unique_lock lock(this->mMutex);
+    if (const auto& it = this->mTopics.find(key);
+        it != this->mTopics.end())
+    {
+        std::erase_if(it->second, [](const auto& outbox) { return outbox->isClosed(); });
+        if (it->second.empty())
+            this->mTopics.erase(it);
+    };
+
+    return delivered;
+};
@@ -0,0 +1,40 @@
+#ifndef WEBSOCKETHUB_HPP
+#define WEBSOCKETHUB_HPP
+
+#include <cstdint>
+#include <memory>
+#include <shared_mutex>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "WebSocket.hpp"
+#include "WebSocketOutbox.hpp"
+
+// Topics WebSockets subscribe to. A published message is framed once into an
+// immutable buffer that every subscriber's outbox queues, so fanning it out
+// costs a reference per subscriber rather than a copy. Subscribers that closed
+// are dropped by the next publish to their topic
+class WebSocketHub
+{
+private:
+    std::unordered_map<std::string, std::vector<std::shared_ptr<WebSocketOutbox>>> mTopics{};
+    std::shared_mutex mMutex{};
+
+public:
+    void subscribe(const std::string& topic, const WebSocket& webSocket);
+    void unsubscribe(const std::string& topic, const WebSocket& webSocket);
+
+    // How many subscribers the message was queued for
+    size_t publish(std::string_view topic, std::string_view text);
+    size_t publish(std::string_view topic, std::span<const uint8_t> binary);
+
+    [[nodiscard]] size_t getSubscriberCount(std::string_view topic);
+
+private:
+    size_t publish(std::string_view topic, const std::shared_ptr<const std::string>& frame);
+};
+
+#endif //WEBSOCKETHUB_HPP
@@ -0,0 +1,229 @@
+#include <algorithm>
+#include <array>
+#include <cerrno>
+
+#if defined(__unix__) || defined(__APPLE__)
+    #include <climits>
+    #include <poll.h>
+    #include <sys/socket.h>
+    #include <sys/uio.h>
+#endif
+
+#if defined(__linux__)
+    #include <thread>
+    #include <unordered_map>
+
+    #include <sys/epoll.h>
+#endif
+
+#include "WebSocketOutbox.hpp"
+#include "HttpServer.hpp"
+
+#if defined(MSG_NOSIGNAL)
+constexpr int sSendFlags = MSG_NOSIGNAL;
+#else
+constexpr int sSendFlags = 0;
+#endif
+
+#if defined(__linux__)
+// Waits for the sockets of every outbox that stopped taking data, and finishes their writes
+class OutboxWriter
+{
+private:
+    static constexpr int sMaxEvents = 64;
+
+    int mEpollFd{ -1 };
+    std::unordered_map<WebSocketOutbox*, std::shared_ptr<WebSocketOutbox>> mWaiting{};
+    std::mutex mMutex{};
+
+public:
+    // Never destroyed, an outbox may still be waiting while statics are torn down
+    static OutboxWriter& get() {
+        static auto* writer = new OutboxWriter();
+        return *writer;
+    };
+
+    void watch(const Socket_t socket, std::shared_ptr<WebSocketOutbox> outbox) {
+        epoll_event event{};
+        event.events = EPOLLOUT | EPOLLONESHOT;
+        event.data.ptr = outbox.get();
+
+        std::unique_lock lock(this->mMutex);
+        this->mWaiting[outbox.get()] = std::move(outbox);
+
+        // Registrations that already fired are only disabled, not removed
+        if (epoll_ctl(this->mEpollFd, EPOLL_CTL_ADD, socket, &event) < 0 && errno == EEXIST)
+            epoll_ctl(this->mEpollFd, EPOLL_CTL_MOD, socket, &event);
+    };
+
+    void forget(const Socket_t socket, WebSocketOutbox* outbox) {
+        std::unique_lock lock(this->mMutex);
+        epoll_ctl(this->mEpollFd, EPOLL_CTL_DEL, socket, nullptr);
+        this->mWaiting.erase(outbox);
+    };
+
+private:
+    OutboxWriter() {
+        this->mEpollFd = epoll_create1(EPOLL_CLOEXEC);
+        if (this->mEpollFd < 0) {
+            throw std::runtime_error("Failed to create epoll instance");
+        };
+
+        std::thread(&OutboxWriter::run, this).detach();
+    };
+
+    void run() {
+        std::array<epoll_event, sMaxEvents> events{};
+        while (true)
+        {
+            const int count = epoll_wait(this->mEpollFd, events.data(), sMaxEvents, -1);
+            for (int i = 0; i < count; ++i)
+            {
+                std::shared_ptr<WebSocketOutbox> outbox;
+                {
+                    std::unique_lock lock(this->mMutex);
+                    const auto& it = this->mWaiting.find(static_cast<WebSocketOutbox*>(events[i].data.ptr));
+                    if (it == this->mWaiting.end())
+                        continue;
+
+                    outbox = std::move(it->second);
+                    this->mWaiting.erase(it);
+                };
+
+                outbox->resume();
+            };
+        };
+    };
+};
+#endif
+
+bool WebSocketOutbox::push(std::shared_ptr<const std::string> frame)
+{
+    std::unique_lock lock(this->mMutex);
+    if (this->b_mIsClosed)
+        return false;
+
+    if (!this->mFrames.empty() && this->mSize + frame->size() > sMaxQueuedSize)
+    {
+        // Nothing more is queued for a peer that can't keep up, the connection finds out on its next read and runs onClose
+        this->discard();
+#if defined(_WIN32)
+        ::shutdown(this->mSocket, SD_BOTH);
+#elif defined(__unix__) || defined(__APPLE__)
+        ::shutdown(this->mSocket, SHUT_RDWR);
+#endif
+        return false;
+    };
+
+    this->mSize += frame->size();
+    this->mFrames.push_back(std::move(frame));
+
+    if (!this->b_mIsWaiting)
+        this->flush();
+
+    return !this->b_mIsClosed;
+};
+
+void WebSocketOutbox::resume()
+{
+    std::unique_lock lock(this->mMutex);
+    this->b_mIsWaiting = false;
+    if (!this->b_mIsClosed)
+        this->flush();
+};
+
+void WebSocketOutbox::close()
+{
+    std::unique_lock lock(this->mMutex);
+    this->discard();
+};
+
+void WebSocketOutbox::discard()
+{
+    this->b_mIsClosed = true;
+    this->mFrames.clear();
+    this->mSize = this->mOffset = 0;
+
+#if defined(__linux__)
+    if (this->b_mIsWaiting)
+        OutboxWriter::get().forget(this->mSocket, this);
+#endif
+    this->b_mIsWaiting = false;
+};
+
+bool WebSocketOutbox::isClosed()
+{
+    std::unique_lock lock(this->mMutex);
+    return this->b_mIsClosed;
+};
+
+void WebSocketOutbox::flush()
+{
+    // Written while locked so close() never returns in the middle of a write
+    while (!this->mFrames.empty())
+    {
+#if defined(_WIN32)
+        const auto& frame = std::string_view{ *this->mFrames.front() }.substr(this->mOffset);
+        if (!HttpServer::sendToSocket(this->mSocket, frame))
+        {
+            this->discard();
+            return;
+        };
+
+        const size_t bytesSent = frame.size();
+#elif defined(__unix__) || defined(__APPLE__)
+        std::array<iovec, std::min<size_t>(IOV_MAX, sMaxVectors)> vectors;
+        size_t count = 0;
+        for (auto it = this->mFrames.begin(); it != this->mFrames.end() && count < vectors.size(); ++it)
+        {
+            const size_t offset = count == 0 ? this->mOffset : 0;
+            vectors[count++] = { const_cast<char*>((*it)->data()) + offset, (*it)->size() - offset };
+        };
+
+        // writev() with flags, a peer that went away doesn't raise SIGPIPE
+        msghdr message{};
+        message.msg_iov = vectors.data();
+        message.msg_iovlen = count;
+
+        const ssize_t bytesSent = ::sendmsg(this->mSocket, &message, sSendFlags);
+        if (bytesSent < 0)
+        {
+            if (errno == EINTR)
+                continue;
+
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+            {
+#if defined(__linux__)
+                this->b_mIsWaiting = true;
+                OutboxWriter::get().watch(this->mSocket, this->shared_from_this());
+                return;
+#else
+                pollfd descriptor{ this->mSocket, POLLOUT, 0 };
+                if (::poll(&descriptor, 1, sSendTimeoutMs) > 0)
+                    continue;
+#endif
+            };
+
+            // The peer is gone, the connection finds out on its next read
+            this->discard();
+            return;
+        };
+#endif
+
+        auto remaining = static_cast<size_t>(bytesSent);
+        this->mSize -= remaining;
+        while (remaining > 0)
+        {
+            const size_t left = this->mFrames.front()->size() - this->mOffset;
+            if (remaining < left)
+            {
+                this->mOffset += remaining;
+                break;
+            };
+
+            remaining -= left;
+            this->mOffset = 0;
+            this->mFrames.pop_front();
+        };
+    };
+};
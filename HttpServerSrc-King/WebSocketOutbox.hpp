@@ -0,0 +1,55 @@
+#ifndef WEBSOCKETOUTBOX_HPP
+#define WEBSOCKETOUTBOX_HPP
+
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include "Common.hpp"
+
+// Frames waiting to be written to one WebSocket, shared by everything that sends
+// to it so frames never interleave. Frames are refcounted, a broadcast queues the
+// same buffer for every subscriber. Whoever queues a frame writes out as much as
+// the socket takes at once with writev(), on Linux a socket that's full is left
+// to a single writer thread instead of blocking the sender
+class WebSocketOutbox : public std::enable_shared_from_this<WebSocketOutbox>
+{
+private:
+    // Queued bytes a peer that doesn't read can hold up before it's disconnected
+    static constexpr size_t sMaxQueuedSize = 16 * 1024 * 1024;
+    static constexpr size_t sMaxVectors = 64;
+    static constexpr int sSendTimeoutMs = 30000;
+
+    Socket_t mSocket{ 0 };
+    std::deque<std::shared_ptr<const std::string>> mFrames{};
+    // Bytes of the first frame that were written already
+    size_t mOffset{ 0 };
+    size_t mSize{ 0 };
+    bool b_mIsClosed{ false };
+    // Left to the writer thread until the socket takes data again
+    bool b_mIsWaiting{ false };
+    std::mutex mMutex{};
+
+public:
+    explicit WebSocketOutbox(const Socket_t socket) : mSocket(socket) {};
+
+    WebSocketOutbox(const WebSocketOutbox&) = delete;
+    WebSocketOutbox& operator=(const WebSocketOutbox&) = delete;
+
+    // Queues a complete frame and writes what it can, false once the socket is closed
+    bool push(std::shared_ptr<const std::string> frame);
+    // Called by the writer thread once the socket takes data again
+    void resume();
+    // Drops whatever is queued, nothing is written after it returns (so the socket can be closed)
+    void close();
+
+    [[nodiscard]] bool isClosed();
+
+private:
+    void flush();
+    // Closes the queue and drops what's in it, with the mutex held
+    void discard();
+};
+
+#endif //WEBSOCKETOUTBOX_HPP
@@ -0,0 +1,235 @@
+#include <algorithm>
+#include <cstring>
+
+#include "WebSocketReader.hpp"
+
+std::span<uint8_t> WebSocketReader::prepare()
+{
+    // Large buffers are let go of once whatever grew them has been handed out
+    const bool isLarge = this->mBuffer.size() > sMaxRetainedSize;
+    if (this->mBuffer.size() - this->mTail < sMinReadSize || isLarge)
+        this->compact();
+
+    if (isLarge && this->mTail <= sMaxRetainedSize / 2)
+    {
+        this->mBuffer.resize(sMaxRetainedSize);
+        this->mBuffer.shrink_to_fit();
+    };
+
+    if (this->mBuffer.size() - this->mTail < sMinReadSize)
+        this->mBuffer.resize(std::max(this->mBuffer.size() * 2, this->mTail + sMinReadSize));
+
+    return { this->mBuffer.data() + this->mTail, this->mBuffer.size() - this->mTail };
+};
+
+void WebSocketReader::commit(const size_t received)
+{
+    this->mTail += received;
+};
+
+void WebSocketReader::append(const std::span<const uint8_t> data)
+{
+    this->compact();
+    if (this->mBuffer.size() - this->mTail < data.size())
+        this->mBuffer.resize(this->mTail + data.size());
+
+    std::ranges::copy(data, this->mBuffer.begin() + static_cast<std::ptrdiff_t>(this->mTail));
+    this->commit(data.size());
+};
+
+WebSocketReader::Status WebSocketReader::read()
+{
+    if (this->mStatus != Status::Incomplete && this->mStatus != Status::Complete)
+        return this->mStatus;
+
+    if (this->b_mDelivered)
+    {
+        this->b_mDelivered = false;
+        if (!this->b_mInMessage)
+            this->mHead = this->mMessageEnd = this->mCursor;
+    };
+
+    while (true)
+    {
+        const Status status = this->mState == State::Header
+            ? this->readHeader()
+            : this->readPayload();
+
+        if (status == Status::Incomplete)
+            return this->mStatus = status;
+
+        if (status != Status::Complete)
+            return this->fail(status);
+
+        if (this->b_mDelivered)
+            return this->mStatus = Status::Complete;
+    };
+};
+
+WebSocketReader::Status WebSocketReader::readHeader()
+{
+    const uint8_t* data = this->mBuffer.data() + this->mCursor;
+    const size_t available = this->mTail - this->mCursor;
+    if (available < 2)
+        return Status::Incomplete;
+
+    const uint8_t opcode = data[0] & 0x0F;
+    const bool isControl = opcode & 0x08;
+
+    // No extensions are negotiated, and every frame from a client has to be masked
+    if ((data[0] & 0x70) != 0 || (data[1] & 0x80) == 0)
+        return Status::Invalid;
+
+    if ((opcode > 0x2 && opcode < 0x8) || opcode > 0xA)
+        return Status::Invalid;
+
+    const uint8_t lengthCode = data[1] & 0x7F;
+    const size_t lengthSize = lengthCode == 126 ? 2 : lengthCode == 127 ? 8 : 0;
+    const size_t headerSize = 2 + lengthSize + 4;
+    if (available < headerSize)
+        return Status::Incomplete;
+
+    uint64_t length = lengthCode;
+    if (lengthSize > 0)
+    {
+        length = 0;
+        for (size_t i = 0; i < lengthSize; ++i)
+            length = (length << 8) | data[2 + i];
+    };
+
+    if (isControl)
+    {
+        // Control frames can't be fragmented or carry more than 125 bytes
+        if ((data[0] & 0x80) == 0 || length > sMaxControlSize)
+            return Status::Invalid;
+    }
+    else
+    {
+        // A continuation without a message, or a new message before the last one ended
+        if ((opcode == 0x0) != this->b_mInMessage)
+            return Status::Invalid;
+
+        if (length > this->mLimits.maxMessageSize - (this->mMessageEnd - this->mHead))
+            return Status::MessageTooLarge;
+    };
+
+    this->mFrameOpcode = opcode;
+    this->b_mIsFinal = data[0] & 0x80;
+    std::copy_n(data + 2 + lengthSize, 4, this->mMask.begin());
+    this->mFrameDecoded = 0;
+    this->mFrameRemaining = static_cast<size_t>(length);
+
+    this->mCursor += headerSize;
+    if (isControl)
+        this->mControlStart = this->mCursor;
+    else if (opcode != 0x0)
+    {
+        // The first frame of a message is never moved
+        this->mOpcode = opcode;
+        this->b_mInMessage = true;
+        this->mUtf8 = {};
+        this->mHead = this->mMessageEnd = this->mCursor;
+    };
+
+    this->mState = State::Payload;
+    return Status::Complete;
+};
+
+WebSocketReader::Status WebSocketReader::readPayload()
+{
+    const size_t count = std::min(this->mFrameRemaining, this->mTail - this->mCursor);
+    const std::span<uint8_t> payload{ this->mBuffer.data() + this->mCursor, count };
+
+    if (this->mFrameOpcode & 0x08)
+        WebSocketPayload::unmask(payload, this->mMask, this->mFrameDecoded);
+    else
+    {
+        if (this->mOpcode == 0x1)
+        {
+            if (!WebSocketPayload::unmaskText(payload, this->mMask, this->mFrameDecoded, this->mUtf8))
+                return Status::InvalidText;
+        }
+        else
+            WebSocketPayload::unmask(payload, this->mMask, this->mFrameDecoded);
+
+        // Decoded bytes never overtake the raw cursor, so moving them down is safe
+        if (this->mMessageEnd != this->mCursor)
+            std::memmove(this->mBuffer.data() + this->mMessageEnd, payload.data(), count);
+
+        this->mMessageEnd += count;
+    };
+
+    this->mCursor += count;
+    this->mFrameDecoded += count;
+    this->mFrameRemaining -= count;
+    if (this->mFrameRemaining > 0)
+        return Status::Incomplete;
+
+    this->mState = State::Header;
+    if (this->mFrameOpcode & 0x08)
+    {
+        this->b_mDelivered = true;
+        this->mResultOpcode = this->mFrameOpcode;
+        this->mResultStart = this->mControlStart;
+        this->mResultEnd = this->mCursor;
+        return Status::Complete;
+    };
+
+    if (!this->b_mIsFinal)
+        return Status::Complete;
+
+    if (this->mOpcode == 0x1 && !WebSocketPayload::isComplete(this->mUtf8))
+        return Status::InvalidText;
+
+    this->b_mInMessage = false;
+    this->b_mDelivered = true;
+    this->mResultOpcode = this->mOpcode;
+    this->mResultStart = this->mHead;
+    this->mResultEnd = this->mMessageEnd;
+    return Status::Complete;
+};
+
+void WebSocketReader::compact()
+{
+    // Wrapping around, whatever is still needed moves back to the start of the buffer in
+    // one piece: the message so far and the bytes after the cursor (or the control frame being read)
+    const size_t rawStart = this->mState == State::Payload && (this->mFrameOpcode & 0x08)
+        ? this->mControlStart
+        : this->mCursor;
+
+    uint8_t* data = this->mBuffer.data();
+    const size_t messageSize = this->mMessageEnd - this->mHead;
+    if (this->mHead > 0)
+        std::memmove(data, data + this->mHead, messageSize);
+
+    const size_t rawSize = this->mTail - rawStart;
+    if (rawStart != messageSize)
+        std::memmove(data + messageSize, data + rawStart, rawSize);
+
+    this->mControlStart = messageSize + (this->mControlStart >= rawStart ? this->mControlStart - rawStart : 0);
+    this->mCursor = messageSize + (this->mCursor - rawStart);
+    this->mTail = messageSize + rawSize;
+    this->mHead = 0;
+    this->mMessageEnd = messageSize;
+};
+
+WebSocketReader::Status WebSocketReader::fail(const Status status)
+{
+    this->b_mDelivered = false;
+    return this->mStatus = status;
+};
+
+uint16_t WebSocketReader::toCloseCode(const Status status)
+{
+    switch (status)
+    {
+        case Status::InvalidText:
+            return 1007;
+
+        case Status::MessageTooLarge:
+            return 1009;
+
+        default:
+            return 1002;
+    };
+};
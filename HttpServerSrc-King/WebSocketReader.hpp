@@ -0,0 +1,105 @@
+#ifndef WEBSOCKETREADER_HPP
+#define WEBSOCKETREADER_HPP
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "util/WebSocketPayload.hpp"
+
+struct WebSocketLimits {
+    // Payload of a whole message, all of its fragments together
+    size_t maxMessageSize{ 16 * 1024 * 1024 };
+};
+
+// Resumable WebSocket framing over a per-connection ring buffer. Frames are
+// decoded as their bytes arrive and unmasked in place, the fragments of a
+// message are moved up against each other so a complete message is always one
+// contiguous span of the buffer. Control frames are handed out as soon as they
+// complete, even in between the fragments of a message
+class WebSocketReader
+{
+public:
+    enum class Status {
+        Incomplete,
+        Complete,
+        Invalid,
+        InvalidText,
+        MessageTooLarge
+    };
+
+private:
+    enum class State {
+        Header,
+        Payload
+    };
+
+    static constexpr size_t sInitialBufferSize = 4096;
+    static constexpr size_t sMinReadSize = 1024;
+    static constexpr size_t sMaxRetainedSize = 65536;
+    static constexpr size_t sMaxControlSize = 125;
+
+    State mState{ State::Header };
+    Status mStatus{ Status::Incomplete };
+    WebSocketLimits mLimits{};
+    std::vector<uint8_t> mBuffer{};
+
+    // Offsets into the buffer: the message decoded so far, the next byte to decode and the end of what was received
+    size_t mHead{ 0 };
+    size_t mMessageEnd{ 0 };
+    size_t mCursor{ 0 };
+    size_t mTail{ 0 };
+
+    // The message being reassembled
+    uint8_t mOpcode{ 0 };
+    bool b_mInMessage{ false };
+    WebSocketPayload::Utf8State mUtf8{};
+
+    // The frame being decoded, control frame payloads stay where they were received
+    uint8_t mFrameOpcode{ 0 };
+    bool b_mIsFinal{ false };
+    std::array<uint8_t, 4> mMask{};
+    size_t mFrameDecoded{ 0 };
+    size_t mFrameRemaining{ 0 };
+    size_t mControlStart{ 0 };
+
+    // What the last Complete handed out, dropped by the next read()
+    bool b_mDelivered{ false };
+    uint8_t mResultOpcode{ 0 };
+    size_t mResultStart{ 0 };
+    size_t mResultEnd{ 0 };
+
+public:
+    explicit WebSocketReader(const WebSocketLimits& limits = {})
+        : mLimits(limits), mBuffer(sInitialBufferSize) {};
+
+    // Free space at the end of the buffer for the next read from the socket, wrapped around or grown as needed
+    std::span<uint8_t> prepare();
+    void commit(size_t received);
+    // Bytes that were received before the reader took over (right after the upgrade request)
+    void append(std::span<const uint8_t> data);
+
+    // Decodes what was received, Complete once a whole message or control frame is ready.
+    // What it hands out is only valid until the next read() or prepare()
+    Status read();
+
+    // What the last read() returned, failures stay
+    [[nodiscard]] Status getStatus() const { return this->mStatus; };
+    [[nodiscard]] uint8_t getOpcode() const { return this->mResultOpcode; };
+    [[nodiscard]] std::span<const uint8_t> getPayload() const {
+        return { this->mBuffer.data() + this->mResultStart, this->mResultEnd - this->mResultStart };
+    };
+
+    // The close status code a connection fails with
+    static uint16_t toCloseCode(Status status);
+
+private:
+    Status readHeader();
+    Status readPayload();
+    Status fail(Status status);
+    void compact();
+};
+
+#endif //WEBSOCKETREADER_HPP
@@ -0,0 +1,102 @@
+#include <algorithm>
+#include <charconv>
+#include <limits>
+
+#include "ByteRange.hpp"
+#include "HeaderName.hpp"
+
+namespace ByteRange
+{
+    inline std::string_view trim(std::string_view text)
+    {
+        text.remove_prefix(std::min(text.find_first_not_of(" \t"), text.size()));
+        text.remove_suffix(text.size() - std::min(text.find_last_not_of(" \t") + 1, text.size()));
+        return text;
+    };
+
+    inline bool parseNumber(const std::string_view text, size_t& value)
+    {
+        const auto& [end, error] = std::from_chars(text.data(), text.data() + text.size(), value);
+        return !text.empty() && error == std::errc{} && end == text.data() + text.size();
+    };
+
+    std::optional<std::vector<Range>> parse(std::string_view header, const size_t size)
+    {
+        header = trim(header);
+        if (header.size() < 6 || !HeaderName::equals(header.substr(0, 6), "bytes="))
+            return std::nullopt;
+
+        header.remove_prefix(6);
+
+        std::vector<Range> ranges;
+        size_t parts = 0;
+        while (!header.empty())
+        {
+            const size_t end = std::min(header.find(','), header.size());
+            const std::string_view part = trim(header.substr(0, end));
+            header.remove_prefix(std::min(end + 1, header.size()));
+
+            if (part.empty())
+                continue;
+
+            // Lots of tiny parts only make the response larger, and are a known way to abuse servers
+            if (++parts > MAX_RANGES * 4)
+                return std::nullopt;
+
+            const size_t dash = part.find('-');
+            if (dash == std::string_view::npos)
+                return std::nullopt;
+
+            size_t first = 0;
+            size_t last = 0;
+            if (dash == 0)
+            {
+                // The last n bytes
+                if (!parseNumber(part.substr(1), last))
+                    return std::nullopt;
+
+                if (last > 0 && size > 0)
+                    ranges.push_back({ size - std::min(last, size), size - 1 });
+
+                continue;
+            };
+
+            if (!parseNumber(part.substr(0, dash), first))
+                return std::nullopt;
+
+            last = std::numeric_limits<size_t>::max();
+            if (dash + 1 < part.size() && !parseNumber(part.substr(dash + 1), last))
+                return std::nullopt;
+
+            if (last < first)
+                return std::nullopt;
+
+            if (first < size)
+                ranges.push_back({ first, std::min(last, size - 1) });
+        };
+
+        if (parts == 0)
+            return std::nullopt;
+
+        std::ranges::sort(ranges, {}, &Range::first);
+
+        std::vector<Range> merged;
+        for (const Range& range : ranges)
+        {
+            if (!merged.empty() && range.first <= merged.back().last + 1)
+                merged.back().last = std::max(merged.back().last, range.last);
+            else
+                merged.push_back(range);
+        };
+
+        if (merged.size() > MAX_RANGES)
+            return std::nullopt;
+
+        return merged;
+    };
+
+    std::string toString(const Range& range, const size_t size)
+    {
+        return "bytes " + std::to_string(range.first) + "-" + std::to_string(range.last) + "/" + std::to_string(size);
+    };
+};
@@ -0,0 +1,30 @@
+#ifndef BYTERANGE_HPP
+#define BYTERANGE_HPP
+
+#include <cstddef>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Range requests: https://www.rfc-editor.org/rfc/rfc9110#section-14
+namespace ByteRange {
+    // Inclusive on both ends, as Content-Range writes them
+    struct Range {
+        size_t first{ 0 };
+        size_t last{ 0 };
+
+        [[nodiscard]] size_t length() const { return this->last - this->first + 1; };
+    };
+
+    // More parts than this in one response are answered with the whole body instead
+    constexpr size_t MAX_RANGES = 16;
+
+    // The ranges a Range header asks for out of a body this size, sorted and with overlapping ones merged.
+    // Nothing when the header is to be ignored (not bytes, malformed, too many parts), empty when none is satisfiable
+    std::optional<std::vector<Range>> parse(std::string_view header, size_t size);
+    // e.g. "bytes 0-499/1234"
+    std::string toString(const Range& range, size_t size);
+};
+
+#endif //BYTERANGE_HPP
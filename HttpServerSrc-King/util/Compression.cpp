@@ -0,0 +1,136 @@
+#include <algorithm>
+#include <charconv>
+#include <limits>
+
+#include <zlib.h>
+
+#include "Compression.hpp"
+#include "HeaderName.hpp"
+
+namespace Compression
+{
+    // The q value of a coding, 1 without one and 0 when it's malformed
+    inline double parseQuality(std::string_view parameters)
+    {
+        while (!parameters.empty())
+        {
+            const size_t end = std::min(parameters.find(';'), parameters.size());
+            std::string_view parameter = parameters.substr(0, end);
+            parameters.remove_prefix(std::min(end + 1, parameters.size()));
+
+            parameter.remove_prefix(std::min(parameter.find_first_not_of(" \t"), parameter.size()));
+            if (parameter.size() < 2 || HeaderName::toLower(parameter[0]) != 'q' || parameter[1] != '=')
+                continue;
+
+            double quality = 0;
+            parameter.remove_prefix(2);
+            if (std::from_chars(parameter.data(), parameter.data() + parameter.size(), quality).ec != std::errc{})
+                return 0;
+
+            return quality;
+        };
+
+        return 1;
+    };
+
+    Qualities parse(std::string_view acceptEncoding)
+    {
+        Qualities qualities{};
+        qualities.fill(-1);
+        float any = 0;
+
+        while (!acceptEncoding.empty())
+        {
+            const size_t end = std::min(acceptEncoding.find(','), acceptEncoding.size());
+            std::string_view coding = acceptEncoding.substr(0, end);
+            acceptEncoding.remove_prefix(std::min(end + 1, acceptEncoding.size()));
+
+            const size_t separator = std::min(coding.find(';'), coding.size());
+            const auto quality = static_cast<float>(parseQuality(coding.substr(separator)));
+            coding = coding.substr(0, separator);
+            coding.remove_prefix(std::min(coding.find_first_not_of(" \t"), coding.size()));
+            coding.remove_suffix(coding.size() - std::min(coding.find_last_not_of(" \t") + 1, coding.size()));
+
+            if (HeaderName::equals(coding, "gzip") || HeaderName::equals(coding, "x-gzip"))
+                qualities[Gzip] = quality;
+            else if (HeaderName::equals(coding, "deflate"))
+                qualities[Deflate] = quality;
+            else if (HeaderName::equals(coding, "br"))
+                qualities[Brotli] = quality;
+            else if (HeaderName::equals(coding, "identity"))
+                qualities[Identity] = quality;
+            else if (coding == "*")
+                any = quality;
+        };
+
+        // Codings that aren't listed are as good as *, if that's there
+        for (auto& quality : qualities)
+        {
+            if (quality < 0)
+                quality = any;
+        };
+
+        return qualities;
+    };
+
+    Encoding negotiate(const Qualities& qualities, const std::span<const Encoding> available)
+    {
+        Encoding best = Identity;
+        float bestQuality = 0;
+
+        for (const Encoding encoding : available)
+        {
+            if (qualities[encoding] > bestQuality)
+            {
+                best = encoding;
+                bestQuality = qualities[encoding];
+            };
+        };
+
+        return best;
+    };
+
+    std::optional<std::string> compress(const std::string_view data, const Encoding encoding)
+    {
+        if (encoding == Identity)
+            return std::string{ data };
+
+        if ((encoding != Gzip && encoding != Deflate) || data.size() > std::numeric_limits<uInt>::max())
+            return std::nullopt;
+
+        // 16 more window bits asks for the gzip wrapper, "deflate" is the zlib format
+        const int windowBits = encoding == Gzip ? MAX_WBITS + 16 : MAX_WBITS;
+
+        z_stream stream{};
+        if (deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, windowBits, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+            return std::nullopt;
+
+        std::string output;
+        output.resize(deflateBound(&stream, static_cast<uLong>(data.size())));
+
+        stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data.data()));
+        stream.avail_in = static_cast<uInt>(data.size());
+        stream.next_out = reinterpret_cast<Bytef*>(output.data());
+        stream.avail_out = static_cast<uInt>(output.size());
+
+        const int result = deflate(&stream, Z_FINISH);
+        output.resize(stream.total_out);
+        deflateEnd(&stream);
+
+        if (result != Z_STREAM_END)
+            return std::nullopt;
+
+        return output;
+    };
+
+    std::string toString(const Encoding encoding)
+    {
+        switch (encoding)
+        {
+            case Gzip: return "gzip";
+            case Deflate: return "deflate";
+            case Brotli: return "br";
+            default: return "identity";
+        };
+    };
+};
@@ -0,0 +1,39 @@
+#ifndef COMPRESSION_HPP
+#define COMPRESSION_HPP
+
+#include <array>
+#include <cstddef>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+
+// Content codings a response body can be sent with, gzip and deflate through zlib.
+// Brotli is only ever served precompressed
+namespace Compression {
+    enum Encoding {
+        Identity,
+        Gzip,
+        Deflate,
+        Brotli
+    };
+
+    // What compress() produces, in the order they're preferred
+    constexpr Encoding COMPRESSORS[] = { Gzip, Deflate };
+
+    // q values of the codings in an Accept-Encoding header, 0 for the ones it doesn't accept
+    using Qualities = std::array<float, Brotli + 1>;
+
+    // Smaller bodies barely shrink, if at all, and aren't worth the time
+    constexpr size_t MIN_SIZE = 1024;
+
+    Qualities parse(std::string_view acceptEncoding);
+    // The available coding rated highest, the earlier one when they're rated the same.
+    // Identity when the client accepts none of them
+    Encoding negotiate(const Qualities& qualities, std::span<const Encoding> available);
+    // Nothing when zlib fails
+    std::optional<std::string> compress(std::string_view data, Encoding encoding);
+    std::string toString(Encoding encoding);
+};
+
+#endif //COMPRESSION_HPP
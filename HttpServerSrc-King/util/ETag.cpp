@@ -0,0 +1,73 @@
+#include <cstdio>
+#include <functional>
+
+#include "ETag.hpp"
+
+namespace ETag
+{
+    inline std::string format(const size_t hash, const size_t size)
+    {
+        char etag[48];
+        const int length = std::snprintf(etag, sizeof(etag), "\"%zx-%zx\"", size, hash);
+        return { etag, static_cast<size_t>(length) };
+    };
+
+    std::string fromContents(const std::string_view contents)
+    {
+        return format(std::hash<std::string_view>{}(contents), contents.size());
+    };
+
+    std::string fromMetadata(const size_t size, const std::time_t modified, const long nanoseconds)
+    {
+        // Mixed so files changed within the same second still differ
+        const size_t hash = std::hash<long long>{}(static_cast<long long>(modified)) * 31 + std::hash<long>{}(nanoseconds);
+        return format(hash, size);
+    };
+
+    std::string withEncoding(const std::string_view etag, const std::string_view encoding)
+    {
+        if (!etag.ends_with('"'))
+            return std::string{ etag };
+
+        std::string tagged{ etag.substr(0, etag.size() - 1) };
+        tagged.append("-").append(encoding).append("\"");
+        return tagged;
+    };
+
+    bool matches(std::string_view list, std::string_view etag)
+    {
+        if (etag.starts_with("W/"))
+            etag.remove_prefix(2);
+
+        while (!list.empty())
+        {
+            const char character = list.front();
+            if (character == ' ' || character == '\t' || character == ',')
+            {
+                list.remove_prefix(1);
+                continue;
+            };
+
+            if (character == '*')
+                return true;
+
+            if (list.starts_with("W/"))
+                list.remove_prefix(2);
+
+            // Quoted, and the quotes are part of the tag
+            if (!list.starts_with('"'))
+                return false;
+
+            const size_t end = list.find('"', 1);
+            if (end == std::string_view::npos)
+                return false;
+
+            if (list.substr(0, end + 1) == etag)
+                return true;
+
+            list.remove_prefix(end + 1);
+        };
+
+        return false;
+    };
+};
@@ -0,0 +1,22 @@
+#ifndef ETAG_HPP
+#define ETAG_HPP
+
+#include <cstddef>
+#include <ctime>
+#include <string>
+#include <string_view>
+
+// Entity tags: https://www.rfc-editor.org/rfc/rfc9110#section-8.8.3
+namespace ETag {
+    // Strong tags, from the bytes themselves or, when they aren't read, from what marks a version of the file
+    std::string fromContents(std::string_view contents);
+    std::string fromMetadata(size_t size, std::time_t modified, long nanoseconds = 0);
+
+    // The same tag with the content coding it was sent with, e.g. "abc-gzip"
+    std::string withEncoding(std::string_view etag, std::string_view encoding);
+
+    // Whether an If-None-Match list holds the tag, compared weakly (W/ is ignored). * holds every tag
+    bool matches(std::string_view list, std::string_view etag);
+};
+
+#endif //ETAG_HPP
@@ -0,0 +1,131 @@
+#ifndef HEADERNAME_HPP
+#define HEADERNAME_HPP
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+namespace HeaderName
+{
+    // Request headers the server and most handlers look at, each gets its own slot in HttpRequest
+    enum Id {
+        Host = 0,
+        Connection,
+        Upgrade,
+        ContentLength,
+        ContentType,
+        TransferEncoding,
+        Expect,
+        Accept,
+        AcceptEncoding,
+        Range,
+        IfRange,
+        IfNoneMatch,
+        IfModifiedSince,
+        Cookie,
+        Authorization,
+        UserAgent,
+        Origin,
+        SecWebSocketKey,
+        SecWebSocketVersion,
+        SecWebSocketProtocol,
+        SecWebSocketExtensions,
+        Unknown
+    };
+
+    inline constexpr std::array<std::string_view, Unknown> sNames = {
+        "Host",
+        "Connection",
+        "Upgrade",
+        "Content-Length",
+        "Content-Type",
+        "Transfer-Encoding",
+        "Expect",
+        "Accept",
+        "Accept-Encoding",
+        "Range",
+        "If-Range",
+        "If-None-Match",
+        "If-Modified-Since",
+        "Cookie",
+        "Authorization",
+        "User-Agent",
+        "Origin",
+        "Sec-WebSocket-Key",
+        "Sec-WebSocket-Version",
+        "Sec-WebSocket-Protocol",
+        "Sec-WebSocket-Extensions"
+    };
+
+    constexpr char toLower(const char c)
+    {
+        return c >= 'A' && c <= 'Z' ? static_cast<char>(c + ('a' - 'A')) : c;
+    };
+
+    constexpr bool equals(const std::string_view a, const std::string_view b)
+    {
+        if (a.size() != b.size())
+            return false;
+
+        for (size_t i = 0; i < a.size(); ++i)
+        {
+            if (toLower(a[i]) != toLower(b[i]))
+                return false;
+        };
+
+        return true;
+    };
+
+    // FNV-1a over the lowercased name
+    constexpr uint32_t hash(const std::string_view name)
+    {
+        uint32_t value = 2166136261u;
+        for (const char c : name)
+            value = (value ^ static_cast<uint8_t>(toLower(c))) * 16777619u;
+
+        return value;
+    };
+
+    inline constexpr std::string_view toString(const Id id)
+    {
+        return id < Unknown ? sNames[id] : std::string_view{};
+    };
+
+    // Length and first letter tell every well-known name apart, they're perfectly hashed into 64 slots
+    constexpr size_t slot(const std::string_view name)
+    {
+        return (name.size() + 13 * static_cast<uint8_t>(toLower(name.front()))) & 63;
+    };
+
+    inline constexpr std::array<Id, 64> sSlots = [] {
+        std::array<Id, 64> slots{};
+        slots.fill(Unknown);
+        for (size_t i = 0; i < sNames.size(); ++i)
+            slots[slot(sNames[i])] = static_cast<Id>(i);
+
+        return slots;
+    }();
+
+    static_assert([] {
+        for (size_t i = 0; i < sNames.size(); ++i)
+        {
+            if (sSlots[slot(sNames[i])] != static_cast<Id>(i))
+                return false;
+        };
+
+        return true;
+    }(), "Two well-known header names share a slot");
+
+    // One slot lookup and at most one comparison, whatever the name
+    inline constexpr Id fromString(const std::string_view name)
+    {
+        if (name.empty())
+            return Unknown;
+
+        const Id id = sSlots[slot(name)];
+        return id != Unknown && equals(sNames[id], name) ? id : Unknown;
+    };
+};
+
+#endif //HEADERNAME_HPP
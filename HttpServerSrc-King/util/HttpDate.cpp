@@ -0,0 +1,82 @@
+#include <cstdio>
+#include <cstring>
+
+#include "HttpDate.hpp"
+
+namespace HttpDate
+{
+    std::string toString(const std::time_t time)
+    {
+        std::tm utc{};
+#if defined(_WIN32)
+        gmtime_s(&utc, &time);
+#else
+        gmtime_r(&time, &utc);
+#endif
+
+        char buffer[32];
+        const int length = std::snprintf(buffer, sizeof(buffer), "%s, %02d %s %04d %02d:%02d:%02d GMT",
+            DAYS[utc.tm_wday], utc.tm_mday, MONTHS[utc.tm_mon], utc.tm_year + 1900,
+            utc.tm_hour, utc.tm_min, utc.tm_sec);
+
+        return { buffer, static_cast<size_t>(length) };
+    };
+
+    inline int parseMonth(const char* name)
+    {
+        for (int i = 0; i < 12; ++i)
+        {
+            if (std::strncmp(name, MONTHS[i], 3) == 0)
+                return i;
+        };
+
+        return -1;
+    };
+
+    std::optional<std::time_t> fromString(const std::string_view date)
+    {
+        // Copied so sscanf gets its terminator, a date never needs more
+        char text[64]{};
+        if (date.size() >= sizeof(text))
+            return std::nullopt;
+
+        date.copy(text, date.size());
+
+        std::tm utc{};
+        char month[4]{};
+        int consumed = 0;
+
+        if (std::sscanf(text, "%*3s, %2d %3s %4d %2d:%2d:%2d GMT%n",
+                &utc.tm_mday, month, &utc.tm_year, &utc.tm_hour, &utc.tm_min, &utc.tm_sec, &consumed) == 6
+            && consumed > 0)
+            utc.tm_year -= 1900;
+        else if (std::sscanf(text, "%*[A-Za-z], %2d-%3s-%2d %2d:%2d:%2d GMT%n",
+                &utc.tm_mday, month, &utc.tm_year, &utc.tm_hour, &utc.tm_min, &utc.tm_sec, &consumed) == 6
+            && consumed > 0)
+        {
+            // Two digit years more than 50 years ahead are in the past
+            if (utc.tm_year < 70)
+                utc.tm_year += 100;
+        }
+        else if (std::sscanf(text, "%*3s %3s %d %2d:%2d:%2d %4d%n",
+                month, &utc.tm_mday, &utc.tm_hour, &utc.tm_min, &utc.tm_sec, &utc.tm_year, &consumed) == 6
+            && consumed > 0)
+            utc.tm_year -= 1900;
+        else
+            return std::nullopt;
+
+        utc.tm_mon = parseMonth(month);
+        if (utc.tm_mon < 0 || utc.tm_mday < 1 || utc.tm_mday > 31 || utc.tm_hour > 23 || utc.tm_min > 59 || utc.tm_sec > 60)
+            return std::nullopt;
+
+#if defined(_WIN32)
+        const std::time_t time = _mkgmtime(&utc);
+#else
+        const std::time_t time = timegm(&utc);
+#endif
+        if (time == static_cast<std::time_t>(-1))
+            return std::nullopt;
+
+        return time;
+    };
+};
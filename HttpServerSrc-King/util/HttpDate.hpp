@@ -0,0 +1,21 @@
+#ifndef HTTPDATE_HPP
+#define HTTPDATE_HPP
+
+#include <ctime>
+#include <optional>
+#include <string>
+#include <string_view>
+
+// IMF-fixdate, the format of Date, Last-Modified and If-Modified-Since:
+// https://www.rfc-editor.org/rfc/rfc9110#section-5.6.7
+namespace HttpDate {
+    constexpr const char* DAYS[] = { "Sun", "Mon", "Tue", "Wed", "Thu", "Fri", "Sat" };
+    constexpr const char* MONTHS[] = { "Jan", "Feb", "Mar", "Apr", "May", "Jun", "Jul", "Aug", "Sep", "Oct", "Nov", "Dec" };
+
+    // e.g. "Sun, 06 Nov 1994 08:49:37 GMT", names are never localized
+    std::string toString(std::time_t time);
+    // IMF-fixdate, and the obsolete RFC 850 and asctime() formats recipients still have to accept
+    std::optional<std::time_t> fromString(std::string_view date);
+};
+
+#endif //HTTPDATE_HPP
@@ -2,6 +2,7 @@
 #define HTTPMETHOD_HPP
 
 #include <string>
+#include <string_view>
 #include <algorithm>
 #include <ranges>
 #include <stdexcept>
@@ -50,7 +51,7 @@ namespace HttpMethod
         };
     };
 
-    inline HttpMethod::Method fromString(const std::string& method)
+    inline HttpMethod::Method fromString(const std::string_view method)
     {
         std::string methodString;
         std::ranges::transform(method, std::back_inserter(methodString),
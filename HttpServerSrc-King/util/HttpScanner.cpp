@@ -0,0 +1,124 @@
+#include <array>
+#include <cstdint>
+
+#include "HttpScanner.hpp"
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+    #define HTTPSCANNER_X86
+    #include <immintrin.h>
+#endif
+
+namespace HttpScanner
+{
+    using ScanFn = size_t (*)(const char* data, size_t size);
+
+    template<bool StopAtColon>
+    constexpr std::array<bool, 256> STOP_TABLE = [] {
+        std::array<bool, 256> table{};
+        for (int c = 0; c < 0x20; ++c)
+            table[c] = c != '\t';
+
+        table[0x7F] = true;
+        table[':'] = StopAtColon;
+        return table;
+    }();
+
+    template<bool StopAtColon>
+    size_t scanScalar(const char* data, const size_t size)
+    {
+        for (size_t i = 0; i < size; ++i)
+        {
+            if (STOP_TABLE<StopAtColon>[static_cast<uint8_t>(data[i])])
+                return i;
+        };
+
+        return size;
+    };
+
+#if defined(HTTPSCANNER_X86)
+    // 16 bytes per pcmpestri, the ranges are 0x00-0x08, 0x0A-0x1F, DEL and optionally ':'
+    template<bool StopAtColon>
+    __attribute__((target("sse4.2")))
+    size_t scanSse42(const char* data, const size_t size)
+    {
+        alignas(16) static constexpr char RANGES[16] = { '\x00', '\x08', '\x0A', '\x1F', '\x7F', '\x7F', ':', ':' };
+        const __m128i ranges = _mm_load_si128(reinterpret_cast<const __m128i*>(RANGES));
+        constexpr int rangesLength = StopAtColon ? 8 : 6;
+
+        size_t i = 0;
+        for (; i + 16 <= size; i += 16)
+        {
+            const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+            const int index = _mm_cmpestri(ranges, rangesLength, chunk, 16,
+                _SIDD_UBYTE_OPS | _SIDD_CMP_RANGES | _SIDD_LEAST_SIGNIFICANT);
+            if (index != 16)
+                return i + index;
+        };
+
+        return i + scanScalar<StopAtColon>(data + i, size - i);
+    };
+
+    // 32 bytes per iteration, control characters are found as min(c, 0x1F) == c
+    template<bool StopAtColon>
+    __attribute__((target("avx2")))
+    size_t scanAvx2(const char* data, const size_t size)
+    {
+        const __m256i control = _mm256_set1_epi8(0x1F);
+        const __m256i tab = _mm256_set1_epi8('\t');
+        const __m256i del = _mm256_set1_epi8(0x7F);
+        const __m256i colon = _mm256_set1_epi8(':');
+
+        size_t i = 0;
+        for (; i + 32 <= size; i += 32)
+        {
+            const __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+
+            __m256i stops = _mm256_andnot_si256(_mm256_cmpeq_epi8(chunk, tab),
+                _mm256_cmpeq_epi8(_mm256_min_epu8(chunk, control), chunk));
+            stops = _mm256_or_si256(stops, _mm256_cmpeq_epi8(chunk, del));
+            if constexpr (StopAtColon)
+                stops = _mm256_or_si256(stops, _mm256_cmpeq_epi8(chunk, colon));
+
+            if (const auto mask = static_cast<uint32_t>(_mm256_movemask_epi8(stops)); mask != 0)
+                return i + __builtin_ctz(mask);
+        };
+
+        return i + scanScalar<StopAtColon>(data + i, size - i);
+    };
+#endif
+
+    template<bool StopAtColon>
+    ScanFn selectScan()
+    {
+#if defined(HTTPSCANNER_X86)
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2"))
+            return &scanAvx2<StopAtColon>;
+
+        if (__builtin_cpu_supports("sse4.2"))
+            return &scanSse42<StopAtColon>;
+#endif
+        return &scanScalar<StopAtColon>;
+    };
+
+    const ScanFn LINE_END_SCAN = selectScan<false>();
+    const ScanFn HEADER_NAME_SCAN = selectScan<true>();
+
+    size_t findLineEnd(const std::string_view data, const size_t from)
+    {
+        if (from >= data.size())
+            return std::string_view::npos;
+
+        const size_t index = from + LINE_END_SCAN(data.data() + from, data.size() - from);
+        return index < data.size() ? index : std::string_view::npos;
+    };
+
+    size_t findHeaderName(const std::string_view data, const size_t from)
+    {
+        if (from >= data.size())
+            return std::string_view::npos;
+
+        const size_t index = from + HEADER_NAME_SCAN(data.data() + from, data.size() - from);
+        return index < data.size() ? index : std::string_view::npos;
+    };
+};
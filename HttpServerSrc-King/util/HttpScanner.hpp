@@ -0,0 +1,18 @@
+#ifndef HTTPSCANNER_HPP
+#define HTTPSCANNER_HPP
+
+#include <cstddef>
+#include <string_view>
+
+// Vectorized scans over request heads, AVX2 or SSE4.2 when the CPU has them
+// (picked once at startup), a lookup table everywhere else
+namespace HttpScanner {
+    // First control character other than HTAB (CR, LF, or a byte a header can't contain)
+    // at or after from, npos if there's none
+    size_t findLineEnd(std::string_view data, size_t from);
+
+    // Same as findLineEnd, but also stops at the colon ending a header name
+    size_t findHeaderName(std::string_view data, size_t from);
+};
+
+#endif //HTTPSCANNER_HPP
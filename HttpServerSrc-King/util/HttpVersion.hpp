@@ -2,6 +2,7 @@
 #define HTTPVERSION_HPP
 
 #include <string>
+#include <string_view>
 #include <iterator>
 #include <algorithm>
 #include <stdexcept>
@@ -30,7 +31,7 @@ namespace HttpVersion
         };
     };
 
-    inline Version fromString(const std::string& version)
+    inline Version fromString(const std::string_view version)
     {
         std::string versionString;
         std::ranges::transform(version, std::back_inserter(versionString),
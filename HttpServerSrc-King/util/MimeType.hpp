@@ -1,8 +1,11 @@
 #ifndef MIMETYPE_HPP
 #define MIMETYPE_HPP
 
+#include <algorithm>
 #include <string>
+#include <string_view>
 #include <unordered_map>
+#include <unordered_set>
 #include <filesystem>
 
 class MimeType
@@ -17,6 +20,19 @@ public:
         return sMimeTypeMap[extension];
     };
 
+    // Text and the formats made of it, everything else in the map is compressed already (images, media, archives)
+    static bool isCompressible(std::string_view type)
+    {
+        type = type.substr(0, std::min(type.find(';'), type.size()));
+        while (!type.empty() && (type.back() == ' ' || type.back() == '\t'))
+            type.remove_suffix(1);
+
+        if (type.starts_with("text/") || type.ends_with("+json") || type.ends_with("+xml"))
+            return true;
+
+        return sCompressibleTypes.contains(type);
+    };
+
     inline static std::unordered_map<std::string, std::string> sMimeTypeMap = {
         { ".aac", "audio/aac" },
         { ".abw", "application/x-abiword" },
@@ -95,6 +111,20 @@ public:
         { ".zip", "application/zip" },
         { ".7z", "application/x-7z-compressed" }
     };
+
+    inline static const std::unordered_set<std::string_view> sCompressibleTypes = {
+        "application/javascript",
+        "application/json",
+        "application/rtf",
+        "application/vnd.ms-fontobject",
+        "application/x-csh",
+        "application/x-httpd-php",
+        "application/x-sh",
+        "application/xml",
+        "font/otf",
+        "font/ttf",
+        "image/vnd.microsoft.icon"
+    };
 };
 
 #endif // !MIMETYPE_HPP
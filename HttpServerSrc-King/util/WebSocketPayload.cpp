@@ -0,0 +1,374 @@
+#include <cstring>
+
+#include "WebSocketPayload.hpp"
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+    #define WEBSOCKETPAYLOAD_X86
+    #include <immintrin.h>
+#endif
+
+namespace WebSocketPayload
+{
+    using UnmaskFn = void (*)(uint8_t* data, size_t size, const std::array<uint8_t, 4>& key, size_t offset);
+    // Unmasks everything, returns how far the text was validated up to a character boundary
+    using UnmaskTextFn = size_t (*)(uint8_t* data, size_t size, const std::array<uint8_t, 4>& key, size_t offset, bool& valid);
+
+    void unmaskScalar(uint8_t* data, const size_t size, const std::array<uint8_t, 4>& key, const size_t offset)
+    {
+        size_t i = 0;
+        for (; i < size && (offset + i) % 4 != 0; ++i)
+            data[i] ^= key[(offset + i) % 4];
+
+        // The key repeated over a word, it lines up again every 4 bytes
+        uint64_t wide = 0;
+        for (size_t byte = 0; byte < 8; ++byte)
+            wide |= static_cast<uint64_t>(key[byte % 4]) << (8 * byte);
+
+        for (; i + 8 <= size; i += 8)
+        {
+            uint64_t word;
+            std::memcpy(&word, data + i, 8);
+            word ^= wide;
+            std::memcpy(data + i, &word, 8);
+        };
+
+        for (; i < size; ++i)
+            data[i] ^= key[(offset + i) % 4];
+    };
+
+    // One byte at a time, https://www.unicode.org/versions/Unicode15.0.0/ch03.pdf table 3-7
+    bool validateScalar(const uint8_t* data, const size_t size, Utf8State& state)
+    {
+        for (size_t i = 0; i < size; ++i)
+        {
+            const uint8_t byte = data[i];
+            if (state.needed > 0)
+            {
+                if (byte < state.lower || byte > state.upper)
+                    return false;
+
+                state.lower = 0x80;
+                state.upper = 0xBF;
+                --state.needed;
+                continue;
+            };
+
+            if (byte < 0x80)
+                continue;
+
+            if (byte >= 0xC2 && byte <= 0xDF)
+                state.needed = 1;
+            else if (byte >= 0xE0 && byte <= 0xEF)
+            {
+                state.needed = 2;
+                if (byte == 0xE0)
+                    state.lower = 0xA0;
+                else if (byte == 0xED)
+                    state.upper = 0x9F;
+            }
+            else if (byte >= 0xF0 && byte <= 0xF4)
+            {
+                state.needed = 3;
+                if (byte == 0xF0)
+                    state.lower = 0x90;
+                else if (byte == 0xF4)
+                    state.upper = 0x8F;
+            }
+            else
+                return false;
+        };
+
+        return true;
+    };
+
+    size_t unmaskTextScalar(uint8_t*, size_t, const std::array<uint8_t, 4>&, size_t, bool&)
+    {
+        return 0;
+    };
+
+    // Where the character the last bytes before end belong to starts, end when it's complete
+    inline size_t findCharacterStart(const uint8_t* data, const size_t end)
+    {
+        if (end >= 1 && data[end - 1] >= 0xC0)
+            return end - 1;
+
+        if (end >= 2 && data[end - 2] >= 0xE0)
+            return end - 2;
+
+        if (end >= 3 && data[end - 3] >= 0xF0)
+            return end - 3;
+
+        return end;
+    };
+
+#if defined(WEBSOCKETPAYLOAD_X86)
+    // Keiser and Lemire, "Validating UTF-8 In Less Than One Instruction Per Byte": the high and low
+    // nibble of a byte and the high nibble of the one after it each look up the errors they allow,
+    // every error all three agree on is real. Lengths of 3 and 4 byte sequences are checked apart
+    constexpr uint8_t TOO_SHORT = 1 << 0;
+    constexpr uint8_t TOO_LONG = 1 << 1;
+    constexpr uint8_t OVERLONG_3 = 1 << 2;
+    constexpr uint8_t TOO_LARGE = 1 << 3;
+    constexpr uint8_t SURROGATE = 1 << 4;
+    constexpr uint8_t OVERLONG_2 = 1 << 5;
+    constexpr uint8_t TOO_LARGE_1000 = 1 << 6;
+    constexpr uint8_t OVERLONG_4 = 1 << 6;
+    constexpr uint8_t TWO_CONTS = 1 << 7;
+    constexpr uint8_t CARRY = TOO_SHORT | TOO_LONG | TWO_CONTS;
+
+    alignas(16) constexpr uint8_t BYTE_1_HIGH[16] = {
+        TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG,
+        TWO_CONTS, TWO_CONTS, TWO_CONTS, TWO_CONTS,
+        TOO_SHORT | OVERLONG_2,
+        TOO_SHORT,
+        TOO_SHORT | OVERLONG_3 | SURROGATE,
+        TOO_SHORT | TOO_LARGE | TOO_LARGE_1000 | OVERLONG_4
+    };
+
+    alignas(16) constexpr uint8_t BYTE_1_LOW[16] = {
+        CARRY | OVERLONG_3 | OVERLONG_2 | OVERLONG_4,
+        CARRY | OVERLONG_2,
+        CARRY,
+        CARRY,
+        CARRY | TOO_LARGE,
+        CARRY | TOO_LARGE | TOO_LARGE_1000,
+        CARRY | TOO_LARGE | TOO_LARGE_1000,
+        CARRY | TOO_LARGE | TOO_LARGE_1000,
+        CARRY | TOO_LARGE | TOO_LARGE_1000,
+        CARRY | TOO_LARGE | TOO_LARGE_1000,
+        CARRY | TOO_LARGE | TOO_LARGE_1000,
+        CARRY | TOO_LARGE | TOO_LARGE_1000,
+        CARRY | TOO_LARGE | TOO_LARGE_1000,
+        CARRY | TOO_LARGE | TOO_LARGE_1000 | SURROGATE,
+        CARRY | TOO_LARGE | TOO_LARGE_1000,
+        CARRY | TOO_LARGE | TOO_LARGE_1000
+    };
+
+    alignas(16) constexpr uint8_t BYTE_2_HIGH[16] = {
+        TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT,
+        TOO_LONG | OVERLONG_2 | TWO_CONTS | OVERLONG_3 | TOO_LARGE_1000 | OVERLONG_4,
+        TOO_LONG | OVERLONG_2 | TWO_CONTS | OVERLONG_3 | TOO_LARGE,
+        TOO_LONG | OVERLONG_2 | TWO_CONTS | SURROGATE | TOO_LARGE,
+        TOO_LONG | OVERLONG_2 | TWO_CONTS | SURROGATE | TOO_LARGE,
+        TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT
+    };
+
+    // The key repeated over a vector, it lines up with every block since blocks are a multiple of 4 bytes
+    template<size_t Size>
+    inline std::array<uint8_t, Size> repeatKey(const std::array<uint8_t, 4>& key, const size_t offset)
+    {
+        std::array<uint8_t, Size> repeated{};
+        for (size_t i = 0; i < Size; ++i)
+            repeated[i] = key[(offset + i) % 4];
+
+        return repeated;
+    };
+
+    __attribute__((target("sse2")))
+    void unmaskSse2(uint8_t* data, const size_t size, const std::array<uint8_t, 4>& key, const size_t offset)
+    {
+        const auto repeated = repeatKey<16>(key, offset);
+        const __m128i mask = _mm_loadu_si128(reinterpret_cast<const __m128i*>(repeated.data()));
+
+        size_t i = 0;
+        for (; i + 16 <= size; i += 16)
+        {
+            auto* block = reinterpret_cast<__m128i*>(data + i);
+            _mm_storeu_si128(block, _mm_xor_si128(_mm_loadu_si128(block), mask));
+        };
+
+        unmaskScalar(data + i, size - i, key, offset + i);
+    };
+
+    __attribute__((target("avx2")))
+    void unmaskAvx2(uint8_t* data, const size_t size, const std::array<uint8_t, 4>& key, const size_t offset)
+    {
+        const auto repeated = repeatKey<32>(key, offset);
+        const __m256i mask = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(repeated.data()));
+
+        size_t i = 0;
+        for (; i + 64 <= size; i += 64)
+        {
+            auto* first = reinterpret_cast<__m256i*>(data + i);
+            auto* second = reinterpret_cast<__m256i*>(data + i + 32);
+            _mm256_storeu_si256(first, _mm256_xor_si256(_mm256_loadu_si256(first), mask));
+            _mm256_storeu_si256(second, _mm256_xor_si256(_mm256_loadu_si256(second), mask));
+        };
+
+        for (; i + 32 <= size; i += 32)
+        {
+            auto* block = reinterpret_cast<__m256i*>(data + i);
+            _mm256_storeu_si256(block, _mm256_xor_si256(_mm256_loadu_si256(block), mask));
+        };
+
+        unmaskScalar(data + i, size - i, key, offset + i);
+    };
+
+    __attribute__((target("ssse3")))
+    size_t unmaskTextSsse3(uint8_t* data, const size_t size, const std::array<uint8_t, 4>& key, const size_t offset, bool& valid)
+    {
+        const auto repeated = repeatKey<16>(key, offset);
+        const __m128i mask = _mm_loadu_si128(reinterpret_cast<const __m128i*>(repeated.data()));
+        const __m128i byte1High = _mm_load_si128(reinterpret_cast<const __m128i*>(BYTE_1_HIGH));
+        const __m128i byte1Low = _mm_load_si128(reinterpret_cast<const __m128i*>(BYTE_1_LOW));
+        const __m128i byte2High = _mm_load_si128(reinterpret_cast<const __m128i*>(BYTE_2_HIGH));
+        const __m128i nibble = _mm_set1_epi8(0x0F);
+        const __m128i maxValue = _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+            static_cast<char>(0xEF), static_cast<char>(0xDF), static_cast<char>(0xBF));
+
+        __m128i previous = _mm_setzero_si128();
+        __m128i previousIncomplete = _mm_setzero_si128();
+        __m128i error = _mm_setzero_si128();
+
+        size_t i = 0;
+        for (; i + 16 <= size; i += 16)
+        {
+            auto* block = reinterpret_cast<__m128i*>(data + i);
+            const __m128i input = _mm_xor_si128(_mm_loadu_si128(block), mask);
+            _mm_storeu_si128(block, input);
+
+            if (_mm_movemask_epi8(input) == 0)
+            {
+                error = _mm_or_si128(error, previousIncomplete);
+                previous = input;
+                continue;
+            };
+
+            const __m128i previous1 = _mm_alignr_epi8(input, previous, 15);
+            const __m128i special = _mm_and_si128(
+                _mm_and_si128(
+                    _mm_shuffle_epi8(byte1High, _mm_and_si128(_mm_srli_epi16(previous1, 4), nibble)),
+                    _mm_shuffle_epi8(byte1Low, _mm_and_si128(previous1, nibble))),
+                _mm_shuffle_epi8(byte2High, _mm_and_si128(_mm_srli_epi16(input, 4), nibble)));
+
+            // Third and fourth bytes of a sequence, found from the lead two and three bytes back
+            const __m128i third = _mm_subs_epu8(_mm_alignr_epi8(input, previous, 14), _mm_set1_epi8(static_cast<char>(0xE0 - 0x80)));
+            const __m128i fourth = _mm_subs_epu8(_mm_alignr_epi8(input, previous, 13), _mm_set1_epi8(static_cast<char>(0xF0 - 0x80)));
+            const __m128i must23 = _mm_and_si128(_mm_or_si128(third, fourth), _mm_set1_epi8(static_cast<char>(0x80)));
+
+            error = _mm_or_si128(error, _mm_xor_si128(must23, special));
+            previousIncomplete = _mm_subs_epu8(input, maxValue);
+            previous = input;
+        };
+
+        valid = _mm_movemask_epi8(_mm_cmpeq_epi8(error, _mm_setzero_si128())) == 0xFFFF;
+        return i;
+    };
+
+    __attribute__((target("avx2")))
+    size_t unmaskTextAvx2(uint8_t* data, const size_t size, const std::array<uint8_t, 4>& key, const size_t offset, bool& valid)
+    {
+        const auto repeated = repeatKey<32>(key, offset);
+        const __m256i mask = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(repeated.data()));
+        const __m256i byte1High = _mm256_broadcastsi128_si256(_mm_load_si128(reinterpret_cast<const __m128i*>(BYTE_1_HIGH)));
+        const __m256i byte1Low = _mm256_broadcastsi128_si256(_mm_load_si128(reinterpret_cast<const __m128i*>(BYTE_1_LOW)));
+        const __m256i byte2High = _mm256_broadcastsi128_si256(_mm_load_si128(reinterpret_cast<const __m128i*>(BYTE_2_HIGH)));
+        const __m256i nibble = _mm256_set1_epi8(0x0F);
+        const __m256i maxValue = _mm256_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+            -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+            static_cast<char>(0xEF), static_cast<char>(0xDF), static_cast<char>(0xBF));
+
+        __m256i previous = _mm256_setzero_si256();
+        __m256i previousIncomplete = _mm256_setzero_si256();
+        __m256i error = _mm256_setzero_si256();
+
+        size_t i = 0;
+        for (; i + 32 <= size; i += 32)
+        {
+            auto* block = reinterpret_cast<__m256i*>(data + i);
+            const __m256i input = _mm256_xor_si256(_mm256_loadu_si256(block), mask);
+            _mm256_storeu_si256(block, input);
+
+            if (_mm256_movemask_epi8(input) == 0)
+            {
+                error = _mm256_or_si256(error, previousIncomplete);
+                previous = input;
+                continue;
+            };
+
+            // The bytes 1, 2 and 3 positions back, across the 128 bit lanes and into the previous block
+            const __m256i carried = _mm256_permute2x128_si256(previous, input, 0x21);
+            const __m256i previous1 = _mm256_alignr_epi8(input, carried, 15);
+            const __m256i previous2 = _mm256_alignr_epi8(input, carried, 14);
+            const __m256i previous3 = _mm256_alignr_epi8(input, carried, 13);
+
+            const __m256i special = _mm256_and_si256(
+                _mm256_and_si256(
+                    _mm256_shuffle_epi8(byte1High, _mm256_and_si256(_mm256_srli_epi16(previous1, 4), nibble)),
+                    _mm256_shuffle_epi8(byte1Low, _mm256_and_si256(previous1, nibble))),
+                _mm256_shuffle_epi8(byte2High, _mm256_and_si256(_mm256_srli_epi16(input, 4), nibble)));
+
+            const __m256i third = _mm256_subs_epu8(previous2, _mm256_set1_epi8(static_cast<char>(0xE0 - 0x80)));
+            const __m256i fourth = _mm256_subs_epu8(previous3, _mm256_set1_epi8(static_cast<char>(0xF0 - 0x80)));
+            const __m256i must23 = _mm256_and_si256(_mm256_or_si256(third, fourth), _mm256_set1_epi8(static_cast<char>(0x80)));
+
+            error = _mm256_or_si256(error, _mm256_xor_si256(must23, special));
+            previousIncomplete = _mm256_subs_epu8(input, maxValue);
+            previous = input;
+        };
+
+        valid = _mm256_testz_si256(error, error) != 0;
+        return i;
+    };
+#endif
+
+    UnmaskFn selectUnmask()
+    {
+#if defined(WEBSOCKETPAYLOAD_X86)
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2"))
+            return &unmaskAvx2;
+
+        if (__builtin_cpu_supports("sse2"))
+            return &unmaskSse2;
+#endif
+        return &unmaskScalar;
+    };
+
+    UnmaskTextFn selectUnmaskText()
+    {
+#if defined(WEBSOCKETPAYLOAD_X86)
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2"))
+            return &unmaskTextAvx2;
+
+        if (__builtin_cpu_supports("ssse3"))
+            return &unmaskTextSsse3;
+#endif
+        return &unmaskTextScalar;
+    };
+
+    const UnmaskFn UNMASK = selectUnmask();
+    const UnmaskTextFn UNMASK_TEXT = selectUnmaskText();
+
+    void unmask(const std::span<uint8_t> payload, const std::array<uint8_t, 4>& key, const size_t offset)
+    {
+        UNMASK(payload.data(), payload.size(), key, offset);
+    };
+
+    bool unmaskText(const std::span<uint8_t> payload, const std::array<uint8_t, 4>& key, const size_t offset, Utf8State& state)
+    {
+        uint8_t* data = payload.data();
+        const size_t size = payload.size();
+
+        // Whatever is left of a character the previous piece ended in
+        size_t start = 0;
+        for (; start < size && state.needed > 0; ++start)
+        {
+            data[start] ^= key[(offset + start) % 4];
+            if (!validateScalar(data + start, 1, state))
+                return false;
+        };
+
+        // Vectors from a character boundary on, then bytes from the start of the character they ended in
+        bool valid = true;
+        const size_t end = start + UNMASK_TEXT(data + start, size - start, key, offset + start, valid);
+        if (!valid)
+            return false;
+
+        UNMASK(data + end, size - end, key, offset + end);
+
+        const size_t resume = end > start ? findCharacterStart(data, end) : end;
+        return validateScalar(data + resume, size - resume, state);
+    };
+};
@@ -0,0 +1,29 @@
+#ifndef WEBSOCKETPAYLOAD_HPP
+#define WEBSOCKETPAYLOAD_HPP
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+// Payloads of masked client frames, unmasked in place and (text) validated as UTF-8 in the
+// same pass. AVX2 or SSSE3 when the CPU has them (picked once at startup), 8 bytes at a time otherwise
+namespace WebSocketPayload {
+    // Where the UTF-8 of a text message stands, carried across the frames (and pieces of frames)
+    // it arrives in: the continuation bytes still owed and the range the next one has to be in
+    struct Utf8State {
+        uint8_t needed{ 0 };
+        uint8_t lower{ 0x80 };
+        uint8_t upper{ 0xBF };
+    };
+
+    // XORs the payload with the masking key, offset is how many bytes of the frame's payload came before it
+    void unmask(std::span<uint8_t> payload, const std::array<uint8_t, 4>& key, size_t offset = 0);
+    // Same as unmask, false as soon as the text stops being valid UTF-8
+    bool unmaskText(std::span<uint8_t> payload, const std::array<uint8_t, 4>& key, size_t offset, Utf8State& state);
+
+    // Whether a text message ends on a whole character
+    inline bool isComplete(const Utf8State& state) { return state.needed == 0; };
+};
+
+#endif //WEBSOCKETPAYLOAD_HPP
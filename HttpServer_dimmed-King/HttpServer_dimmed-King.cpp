@@ -75,42 +75,46 @@ public:
 int main(int argc, char *argv[])
 {
 
+    StaticFileCache fileCache{ fs::current_path() };
+
     httpServer_King.use(R"(/.*)", HttpMethod::GET, [&](const HttpRequest &req, HttpResponse &res)
                         {
             std::string clientIp = req.getRemoteAddr();
-            std::string path = req.getPath();
+            std::string path{ req.getPath() };
             std::string filePath = path == "/" ? fs::current_path().string() + "/index.html" : fs::current_path().string() + path;
-            std::string file_contents = ServerUtils::readFile(filePath);
-            std::string content_type = MimeType::getMimeType(filePath);
+            std::shared_ptr<const StaticFile> file = fileCache.find(filePath);
             std::string method = HttpMethod::toString(req.getMethod());
             bool isBlackListed = false;
             HttpStatus::Code statusCode = HttpStatus::Code::InternalServerError;
 
-            if (fs::exists(filePath)) // File is found
+            if (file || fs::exists(filePath)) // File is found
             {
-                if (file_contents.empty() && !fs::is_directory(filePath)) // File is empty
+                if (!file && fs::is_regular_file(filePath))
+                    file = fileCache.load(filePath, fs::path(filePath).lexically_normal(), fs::path(filePath).lexically_normal());
+
+                if (!file && fs::is_directory(filePath)) // File is a directory
                 {
                     res.setStatus(HttpStatus::Code::NotFound);
                     res.setHeader("Content-Type", "text/html");
-                    res.send(PageEmpty);
+                    res.send(Page404);
 
                     statusCode = HttpStatus::Code::NotFound;
                 }
-                else if (fs::exists(filePath) && fs::is_directory(filePath)) // File is a directory
+                else if (!file || file->size == 0) // File is empty
                 {
                     res.setStatus(HttpStatus::Code::NotFound);
                     res.setHeader("Content-Type", "text/html");
-                    res.send(Page404);
+                    res.send(PageEmpty);
 
                     statusCode = HttpStatus::Code::NotFound;
                 }
                 else // File is ok and ready
                 {
                     res.setStatus(HttpStatus::Code::OK);
-                    res.setHeader("Content-Type", content_type);
-                    res.send(file_contents);
+                    fileCache.serve(res, filePath, file);
 
-                    statusCode = HttpStatus::Code::OK;
+                    // Not Modified, Partial Content, ... when the request asked for it
+                    statusCode = res.getStatus();
                 };
             }
             else // File is not found
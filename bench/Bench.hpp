@@ -0,0 +1,37 @@
+#ifndef BENCH_HPP
+#define BENCH_HPP
+
+#include <chrono>
+#include <cstddef>
+
+namespace Bench
+{
+    // Keeps the compiler from dropping work whose result nobody reads
+    template<typename T>
+    inline void keep(const T& value)
+    {
+#if defined(_MSC_VER)
+        static_cast<void>(*static_cast<const volatile char*>(static_cast<const void*>(&value)));
+#else
+        asm volatile("" : : "r"(&value) : "memory");
+#endif
+    };
+
+    // Calls fn in growing batches until a batch takes at least duration, then returns calls per second
+    template<typename Fn>
+    double perSecond(Fn&& fn, const std::chrono::milliseconds duration = std::chrono::milliseconds(300))
+    {
+        for (size_t iterations = 1;; iterations *= 2)
+        {
+            const auto& start = std::chrono::steady_clock::now();
+            for (size_t i = 0; i < iterations; ++i)
+                fn();
+
+            const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+            if (elapsed >= duration)
+                return static_cast<double>(iterations) / elapsed.count();
+        };
+    };
+};
+
+#endif //BENCH_HPP
@@ -0,0 +1,109 @@
+// Header block scanning throughput, from 200 bytes to 8 KB, with HttpScanner
+// (whatever it picked for this CPU), its scalar lookup table on its own, and
+// the std::string_view::find() calls the parser used before it. find() only
+// looks for ':' and CRLF, the scanners also stop at bytes a header can't hold.
+// Numbers only mean something in an optimized build (-DCMAKE_BUILD_TYPE=Release)
+//
+// ./HeaderScanBench
+
+#include <array>
+#include <cstdint>
+#include <print>
+#include <string>
+#include <string_view>
+
+#include "Bench.hpp"
+#include "util/HttpScanner.hpp"
+
+constexpr std::array<std::string_view, 8> sHeaders = {
+    "Host: shop.example.com\r\n",
+    "User-Agent: Mozilla/5.0 (Windows NT 10.0; Win64; x64) AppleWebKit/537.36 (KHTML, like Gecko) Chrome/124.0.0.0 Safari/537.36\r\n",
+    "Accept: text/html,application/xhtml+xml,application/xml;q=0.9,image/avif,image/webp,*/*;q=0.8\r\n",
+    "Accept-Encoding: gzip, deflate, br, zstd\r\n",
+    "Accept-Language: en-GB,en-US;q=0.9,en;q=0.8\r\n",
+    "Cookie: session=4f1c2a9e7b3d48d2a6e0c51f; theme=dark; cart=3; _ga=GA1.1.1234567890.1700000000\r\n",
+    "Referer: https://shop.example.com/products\r\n",
+    "Sec-Fetch-Mode: navigate\r\n",
+};
+
+// Browser-like headers repeated until the block is about size bytes, ending in the blank line
+std::string makeHeaderBlock(const size_t size)
+{
+    std::string block;
+    for (size_t i = 0; block.size() + sHeaders[i % sHeaders.size()].size() <= size; ++i)
+        block += sHeaders[i % sHeaders.size()];
+
+    return block + "\r\n";
+};
+
+// HttpScanner's fallback, the same table lookup per byte
+template<bool StopAtColon>
+constexpr std::array<bool, 256> STOP_TABLE = [] {
+    std::array<bool, 256> table{};
+    for (int c = 0; c < 0x20; ++c)
+        table[c] = c != '\t';
+
+    table[0x7F] = true;
+    table[':'] = StopAtColon;
+    return table;
+}();
+
+template<bool StopAtColon>
+size_t scanScalar(const std::string_view data, const size_t from)
+{
+    for (size_t i = from; i < data.size(); ++i)
+    {
+        if (STOP_TABLE<StopAtColon>[static_cast<uint8_t>(data[i])])
+            return i;
+    };
+
+    return std::string_view::npos;
+};
+
+// Walks every header the way the parser does, returning the number of headers found
+template<typename FindName, typename FindEnd>
+size_t countHeaders(const std::string_view block, FindName findName, FindEnd findEnd)
+{
+    size_t count = 0, position = 0;
+    while (position < block.size() && block[position] != '\r')
+    {
+        const size_t colon = findName(block, position);
+        const size_t lineEnd = findEnd(block, colon);
+        if (lineEnd == std::string_view::npos)
+            break;
+
+        ++count;
+        position = lineEnd + 2;
+    };
+
+    return count;
+};
+
+int main()
+{
+    std::println("{:>8} {:>16} {:>16} {:>16}", "bytes", "HttpScanner MB/s", "scalar MB/s", "find() MB/s");
+
+    for (const size_t size : { 200, 1024, 4096, 8192 })
+    {
+        const std::string block = makeHeaderBlock(size);
+        const double megabytes = static_cast<double>(block.size()) / (1024.0 * 1024.0);
+
+        const double simd = Bench::perSecond([&] {
+            Bench::keep(countHeaders(block, HttpScanner::findHeaderName, HttpScanner::findLineEnd));
+        });
+
+        const double scalar = Bench::perSecond([&] {
+            Bench::keep(countHeaders(block, scanScalar<true>, scanScalar<false>));
+        });
+
+        const double find = Bench::perSecond([&] {
+            Bench::keep(countHeaders(block,
+                [](const std::string_view data, const size_t from) { return data.find(':', from); },
+                [](const std::string_view data, const size_t from) { return data.find("\r\n", from); }));
+        });
+
+        std::println("{:>8} {:>16.0f} {:>16.0f} {:>16.0f}", block.size(), simd * megabytes, scalar * megabytes, find * megabytes);
+    };
+
+    return 0;
+};
@@ -0,0 +1,139 @@
+// Requests parsed per second for a 20 header browser request, HttpRequest's
+// in-place parser against the copying one it replaced (kept below as it was)
+//
+// ./RequestParserBench
+
+#include <algorithm>
+#include <cctype>
+#include <optional>
+#include <print>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+
+#include "Bench.hpp"
+#include "HttpRequest.hpp"
+
+constexpr std::string_view sBrowserRequest =
+    "GET /products/search?q=keyboard&sort=price HTTP/1.1\r\n"
+    "Host: shop.example.com\r\n"
+    "Connection: keep-alive\r\n"
+    "sec-ch-ua: \"Chromium\";v=\"124\", \"Google Chrome\";v=\"124\", \"Not-A.Brand\";v=\"99\"\r\n"
+    "sec-ch-ua-mobile: ?0\r\n"
+    "sec-ch-ua-platform: \"Windows\"\r\n"
+    "Upgrade-Insecure-Requests: 1\r\n"
+    "User-Agent: Mozilla/5.0 (Windows NT 10.0; Win64; x64) AppleWebKit/537.36 (KHTML, like Gecko) Chrome/124.0.0.0 Safari/537.36\r\n"
+    "Accept: text/html,application/xhtml+xml,application/xml;q=0.9,image/avif,image/webp,*/*;q=0.8\r\n"
+    "Sec-Fetch-Site: same-origin\r\n"
+    "Sec-Fetch-Mode: navigate\r\n"
+    "Sec-Fetch-User: ?1\r\n"
+    "Sec-Fetch-Dest: document\r\n"
+    "Referer: https://shop.example.com/products\r\n"
+    "Accept-Encoding: gzip, deflate, br, zstd\r\n"
+    "Accept-Language: en-GB,en-US;q=0.9,en;q=0.8\r\n"
+    "Cookie: session=4f1c2a9e7b3d48d2a6e0c51f; theme=dark; cart=3; _ga=GA1.1.1234567890.1700000000\r\n"
+    "Cache-Control: max-age=0\r\n"
+    "If-None-Match: \"5e1b-1715000000\"\r\n"
+    "If-Modified-Since: Mon, 06 May 2024 12:00:00 GMT\r\n"
+    "Priority: u=0, i\r\n"
+    "\r\n";
+
+// The parser HttpRequest had before it parsed in place: substr copies of each
+// part, an istringstream over them and a map of owned strings per header
+struct LegacyRequest
+{
+    std::string path{};
+    std::string body{};
+    HttpMethod::Method method{ HttpMethod::GET };
+    std::unordered_map<std::string, std::string> headers{};
+
+    explicit LegacyRequest(const std::string& data)
+    {
+        size_t lpos = 0, rpos = 0;
+        rpos = data.find("\r\n", lpos);
+        if (rpos == std::string::npos)
+            throw std::invalid_argument("Could not find request start line");
+
+        std::string headerBlock, startLine = data.substr(lpos, rpos - lpos);
+
+        lpos = rpos + 2;
+        rpos = data.find("\r\n\r\n", lpos);
+        if (rpos != std::string::npos)
+        {
+            headerBlock = data.substr(lpos, rpos - lpos);
+
+            lpos = rpos + 4, rpos = data.length();
+            if (lpos < rpos)
+                this->body = data.substr(lpos, rpos - lpos);
+        };
+
+        std::istringstream iss{ startLine };
+
+        std::string methodName, version;
+        iss >> methodName >> this->path >> version;
+        this->method = HttpMethod::fromString(methodName);
+
+        iss.clear();
+        iss.str(headerBlock);
+
+        std::string line;
+        while (std::getline(iss, line))
+        {
+            std::string key, value;
+            std::istringstream header{ line };
+
+            std::getline(header, key, ':');
+            std::getline(header, value);
+
+            std::erase_if(key, [](const char& c) { return std::isspace(c); });
+            std::erase_if(value, [](const char& c) { return std::isspace(c); });
+
+            this->headers[key] = value;
+        };
+    };
+
+    // Case-insensitive, the way the old getHeader() searched
+    [[nodiscard]] std::optional<std::string> getHeader(const std::string& name) const
+    {
+        std::string input{ name };
+        std::ranges::transform(input, input.begin(), [](const unsigned char c) { return std::tolower(c); });
+
+        for (const auto& [key, value] : this->headers)
+        {
+            std::string lower{ key };
+            std::ranges::transform(lower, lower.begin(), [](const unsigned char c) { return std::tolower(c); });
+
+            if (lower == input)
+                return value;
+        };
+
+        return std::nullopt;
+    };
+};
+
+int main()
+{
+    // Both are handed a buffer that already holds the request, and look up what a handler typically reads
+    const std::string buffer{ sBrowserRequest };
+
+    const double legacy = Bench::perSecond([&] {
+        const LegacyRequest request{ buffer };
+        Bench::keep(request.getHeader("Host"));
+        Bench::keep(request.getHeader("Accept-Encoding"));
+        Bench::keep(request.getHeader("Cookie"));
+    });
+
+    const double inPlace = Bench::perSecond([&] {
+        const HttpRequest request{ 0, buffer };
+        Bench::keep(request.getHeader(HeaderName::Host));
+        Bench::keep(request.getHeader(HeaderName::AcceptEncoding));
+        Bench::keep(request.getHeader("Cookie"));
+    });
+
+    std::println("{} byte request, 20 headers", sBrowserRequest.size());
+    std::println("{:<24} {:>12.0f} requests/s", "copying parser", legacy);
+    std::println("{:<24} {:>12.0f} requests/s", "in-place parser", inPlace);
+    std::println("{:<24} {:>12.2f}x", "speedup", inPlace / legacy);
+    return 0;
+};
@@ -0,0 +1,113 @@
+// Connections per second, one request each, with a single acceptor feeding
+// the worker queue against one SO_REUSEPORT socket and event loop per worker,
+// for 1 up to every hardware thread.
+//
+// ./ReusePortBench [seconds per run] [client threads]
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <print>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "HttpServer.hpp"
+
+constexpr unsigned short sPort = 18480;
+constexpr std::string_view sRequest = "GET /ping HTTP/1.1\r\nHost: bench\r\nConnection: close\r\n\r\n";
+
+// Connects, sends the request and reads until the server closes, false when any of it failed
+bool roundTrip()
+{
+    const int socket = ::socket(AF_INET, SOCK_STREAM, 0);
+    if (socket < 0)
+        return false;
+
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(sPort);
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    bool answered = false;
+    if (connect(socket, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) == 0
+        && write(socket, sRequest.data(), sRequest.size()) == static_cast<ssize_t>(sRequest.size()))
+    {
+        char buffer[512];
+        ssize_t bytesRead;
+        while ((bytesRead = read(socket, buffer, sizeof(buffer))) > 0)
+            answered = true;
+    };
+
+    ::close(socket);
+    return answered;
+};
+
+double measure(const bool reusePort, const unsigned int workers, const unsigned int clients, const std::chrono::milliseconds duration)
+{
+    HttpServer::setWorkerThreads(workers);
+
+    HttpServer server{};
+    server.setReusePort(reusePort);
+    server.use("/ping", HttpMethod::GET, [](const HttpRequest&, HttpResponse& response) {
+        response.send("pong");
+    });
+
+    std::thread listener([&server] { server.listen("127.0.0.1", sPort); });
+    while (!roundTrip())
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+    std::atomic<bool> isRunning{ true };
+    std::atomic<size_t> completed{ 0 };
+    std::vector<std::thread> threads;
+    for (unsigned int i = 0; i < clients; ++i)
+    {
+        threads.emplace_back([&] {
+            size_t count = 0;
+            while (isRunning.load(std::memory_order_relaxed))
+                count += roundTrip();
+
+            completed += count;
+        });
+    };
+
+    const auto& start = std::chrono::steady_clock::now();
+    std::this_thread::sleep_for(duration);
+    isRunning = false;
+
+    for (auto& thread : threads)
+        thread.join();
+
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    server.close();
+    listener.join();
+    return static_cast<double>(completed.load()) / elapsed.count();
+};
+
+int main(const int argc, char** argv)
+{
+    const auto duration = std::chrono::milliseconds(argc > 1 ? std::atoi(argv[1]) * 1000 : 2000);
+    const unsigned int cores = std::max(1u, std::thread::hardware_concurrency());
+    const unsigned int clients = argc > 2 ? std::atoi(argv[2]) : cores;
+
+    std::println("{:>8} {:>18} {:>18}", "workers", "shared accept/s", "SO_REUSEPORT/s");
+    // Doubling up to every core, even when that isn't a power of two
+    for (unsigned int workers = 1;; workers = std::min(workers * 2, cores))
+    {
+        const double shared = measure(false, workers, clients, duration);
+        const double reusePort = measure(true, workers, clients, duration);
+        std::println("{:>8} {:>18.0f} {:>18.0f}", workers, shared, reusePort);
+
+        if (workers == cores)
+            break;
+    };
+
+    return 0;
+};
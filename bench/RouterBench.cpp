@@ -0,0 +1,101 @@
+// Route lookups per second with 10 to 10,000 registered routes, Router against
+// the loop it replaced, which compiled a std::regex from every route on each
+// request. That loop is only run up to 1,000 routes, past that a single
+// lookup takes long enough that the table would take minutes
+//
+// ./RouterBench
+
+#include <print>
+#include <regex>
+#include <string>
+#include <vector>
+
+#include "Bench.hpp"
+#include "Router.hpp"
+
+constexpr size_t sMaxRegexRoutes = 1000;
+
+// A mix of what sites register: literal pages, a [^/]+ parameter and a .* subtree
+std::vector<std::string> makeRoutes(const size_t count)
+{
+    std::vector<std::string> routes;
+    for (size_t i = 0; routes.size() < count; ++i)
+    {
+        switch (i % 3)
+        {
+        case 0: routes.push_back("/page" + std::to_string(i)); break;
+        case 1: routes.push_back("/api/v1/resource" + std::to_string(i) + "/[^/]+"); break;
+        default: routes.push_back("/files" + std::to_string(i) + "/.*"); break;
+        };
+    };
+
+    return routes;
+};
+
+// One path for each kind of route spread over the table, and one that matches nothing
+std::vector<std::string> makePaths(const size_t count)
+{
+    const size_t last = count - 1 - (count - 1) % 3;
+    return {
+        "/page0",
+        "/api/v1/resource" + std::to_string(count / 3 / 3 * 3 + 1) + "/42",
+        "/files" + std::to_string(last >= 3 ? last - 1 : 2) + "/css/site.css",
+        "/page" + std::to_string(last),
+        "/missing/path",
+    };
+};
+
+// The lookup HttpServer did before Router, kept as it was
+bool findRegex(const std::string& path, const std::vector<std::string>& routes)
+{
+    for (const auto& route : routes)
+    {
+        bool matches = false;
+        try {
+            const std::regex pattern{ route };
+            matches = std::regex_match(path.begin(), path.end(), pattern);
+        }
+        catch (...) {
+            matches = (route == path);
+        };
+
+        if (true == matches)
+            return true;
+    };
+
+    return false;
+};
+
+int main()
+{
+    std::println("{:>8} {:>18} {:>18}", "routes", "Router lookups/s", "regex lookups/s");
+
+    for (const size_t count : { 10, 100, 1000, 10000 })
+    {
+        const std::vector<std::string> routes = makeRoutes(count);
+        const std::vector<std::string> paths = makePaths(count);
+
+        Router router;
+        for (const auto& route : routes)
+            router.add(route);
+
+        size_t next = 0;
+        const double tree = Bench::perSecond([&] {
+            Bench::keep(router.find(paths[next++ % paths.size()]));
+        });
+
+        if (count > sMaxRegexRoutes)
+        {
+            std::println("{:>8} {:>18.0f} {:>18}", count, tree, "-");
+            continue;
+        };
+
+        const double regex = Bench::perSecond([&] {
+            Bench::keep(findRegex(paths[next++ % paths.size()], routes));
+        });
+
+        std::println("{:>8} {:>18.0f} {:>18.0f}", count, tree, regex);
+    };
+
+    return 0;
+};
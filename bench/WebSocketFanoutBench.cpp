@@ -0,0 +1,146 @@
+// Fan-out to local subscribers over socket pairs, WebSocketHub::publish()
+// against sending to each WebSocket in turn (a frame encoded per subscriber).
+// Reports how long the publishing loop took and how long until every
+// subscriber had read every message. Sending to each socket copies the frame
+// for every subscriber, so large messages need that much memory while queued
+//
+// ./WebSocketFanoutBench [subscribers] [messages] [message bytes]
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <memory>
+#include <print>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "Bench.hpp"
+#include "WebSocketHub.hpp"
+
+// Raises the descriptor limit as far as allowed, returns how many subscribers fit in it
+size_t fitSubscribers(const size_t wanted)
+{
+    rlimit limit{};
+    getrlimit(RLIMIT_NOFILE, &limit);
+    limit.rlim_cur = limit.rlim_max;
+    setrlimit(RLIMIT_NOFILE, &limit);
+    getrlimit(RLIMIT_NOFILE, &limit);
+
+    // Two descriptors per subscriber, and some left for the process
+    const size_t available = limit.rlim_cur > 64 ? (limit.rlim_cur - 64) / 2 : 0;
+    return std::min(wanted, available);
+};
+
+struct Result {
+    double publishMs{ 0 };
+    double deliveredMs{ 0 };
+};
+
+// Connects subscribers, sends messages to all of them through publish and waits until they were all read
+template<typename Publish>
+Result measure(const size_t subscribers, const size_t messages, const std::string& message, Publish publish)
+{
+    const auto request = std::make_shared<const HttpRequest>(0, "GET /ws HTTP/1.1\r\nHost: bench\r\n\r\n");
+
+    std::vector<int> sockets, peers;
+    std::vector<WebSocket> webSockets;
+    webSockets.reserve(subscribers);
+    WebSocketHub hub;
+    for (size_t i = 0; i < subscribers; ++i)
+    {
+        int pair[2];
+        if (socketpair(AF_UNIX, SOCK_STREAM, 0, pair) != 0)
+            throw std::runtime_error("socketpair failed");
+
+        // The server's end doesn't block, like a connection the event loop owns
+        fcntl(pair[0], F_SETFL, fcntl(pair[0], F_GETFL) | O_NONBLOCK);
+        sockets.push_back(pair[0]);
+        peers.push_back(pair[1]);
+        webSockets.emplace_back(pair[0], request);
+        hub.subscribe("bench", webSockets.back());
+    };
+
+    const size_t frameSize = WebSocket::encodeFrame(0x1, { reinterpret_cast<const uint8_t*>(message.data()), message.size() }).size();
+    const size_t expected = frameSize * messages;
+
+    // Each reader drains its share of the subscribers, one after the other
+    std::atomic<size_t> delivered{ 0 };
+    std::vector<std::thread> readers;
+    const unsigned int readerCount = std::max(1u, std::thread::hardware_concurrency());
+    for (unsigned int reader = 0; reader < readerCount; ++reader)
+    {
+        readers.emplace_back([&, reader] {
+            std::vector<char> buffer(64 * 1024);
+            for (size_t i = reader; i < peers.size(); i += readerCount)
+            {
+                size_t received = 0;
+                ssize_t bytesRead;
+                while (received < expected && (bytesRead = read(peers[i], buffer.data(), buffer.size())) > 0)
+                    received += bytesRead;
+
+                delivered += received == expected;
+            };
+        });
+    };
+
+    const auto& start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < messages; ++i)
+        publish(hub, webSockets, message);
+
+    const auto& published = std::chrono::steady_clock::now();
+    for (auto& thread : readers)
+        thread.join();
+
+    const auto& finished = std::chrono::steady_clock::now();
+    if (delivered != subscribers)
+        std::println("only {} of {} subscribers got every message", delivered.load(), subscribers);
+
+    for (const auto& webSocket : webSockets)
+        webSocket.closeSocket();
+
+    webSockets.clear();
+    for (size_t i = 0; i < subscribers; ++i)
+    {
+        ::close(sockets[i]);
+        ::close(peers[i]);
+    };
+
+    return {
+        std::chrono::duration<double, std::milli>(published - start).count(),
+        std::chrono::duration<double, std::milli>(finished - start).count(),
+    };
+};
+
+int main(const int argc, char** argv)
+{
+    const size_t wanted = argc > 1 ? std::atoi(argv[1]) : 10000;
+    const size_t messages = argc > 2 ? std::atoi(argv[2]) : 20;
+    const std::string message(argc > 3 ? std::atoi(argv[3]) : 128, 'x');
+
+    const size_t subscribers = fitSubscribers(wanted);
+    if (subscribers < wanted)
+        std::println("descriptor limit allows {} subscribers", subscribers);
+
+    const Result perSocket = measure(subscribers, messages, message, [](WebSocketHub&, const std::vector<WebSocket>& webSockets, const std::string& text) {
+        for (const auto& webSocket : webSockets)
+            webSocket.send(text);
+    });
+
+    const Result hub = measure(subscribers, messages, message, [](WebSocketHub& hub, const std::vector<WebSocket>&, const std::string& text) {
+        Bench::keep(hub.publish("bench", text));
+    });
+
+    std::println("{} subscribers, {} messages of {} bytes", subscribers, messages, message.size());
+    std::println("{:<24} {:>14} {:>14}", "", "publish ms", "delivered ms");
+    std::println("{:<24} {:>14.1f} {:>14.1f}", "WebSocket::send each", perSocket.publishMs, perSocket.deliveredMs);
+    std::println("{:<24} {:>14.1f} {:>14.1f}", "WebSocketHub::publish", hub.publishMs, hub.deliveredMs);
+    return 0;
+};
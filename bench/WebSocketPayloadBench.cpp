@@ -0,0 +1,130 @@
+// Payload throughput for 100 B, 4 KB and 1 MB client frames, WebSocketPayload
+// against what the server did before it: XOR a byte at a time into a new
+// vector and, for text, check the UTF-8 a byte at a time. Every iteration
+// copies the masked frame back into the receive buffer first, as unmasking
+// is done in place
+//
+// ./WebSocketPayloadBench
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <print>
+#include <string_view>
+#include <vector>
+
+#include "Bench.hpp"
+#include "util/WebSocketPayload.hpp"
+
+constexpr std::array<uint8_t, 4> sKey = { 0x37, 0xFA, 0x21, 0x3D };
+
+// Mostly ASCII chat text with two, three and four byte characters mixed in
+std::vector<uint8_t> makeText(const size_t size)
+{
+    constexpr std::string_view sample = "Hello, wörld, the price is 5€, 你好 🙂 see you tomorrow. ";
+
+    std::vector<uint8_t> text;
+    while (text.size() + sample.size() <= size)
+        text.insert(text.end(), sample.begin(), sample.end());
+
+    text.resize(size, ' ');
+    return text;
+};
+
+// One byte at a time, https://www.unicode.org/versions/Unicode15.0.0/ch03.pdf table 3-7
+bool validateBytewise(const std::vector<uint8_t>& data)
+{
+    uint8_t needed = 0, lower = 0x80, upper = 0xBF;
+    for (const uint8_t byte : data)
+    {
+        if (needed > 0)
+        {
+            if (byte < lower || byte > upper)
+                return false;
+
+            lower = 0x80, upper = 0xBF;
+            --needed;
+            continue;
+        };
+
+        if (byte < 0x80)
+            continue;
+
+        if (byte >= 0xC2 && byte <= 0xDF)
+            needed = 1;
+        else if (byte >= 0xE0 && byte <= 0xEF)
+        {
+            needed = 2;
+            if (byte == 0xE0)
+                lower = 0xA0;
+            else if (byte == 0xED)
+                upper = 0x9F;
+        }
+        else if (byte >= 0xF0 && byte <= 0xF4)
+        {
+            needed = 3;
+            if (byte == 0xF0)
+                lower = 0x90;
+            else if (byte == 0xF4)
+                upper = 0x8F;
+        }
+        else
+            return false;
+    };
+
+    return needed == 0;
+};
+
+// The decode loop HttpServer had before WebSocketPayload
+std::vector<uint8_t> unmaskBytewise(const std::vector<uint8_t>& buffer)
+{
+    std::vector<uint8_t> payload;
+    payload.reserve(buffer.size());
+
+    for (size_t i = 0; i < buffer.size(); ++i)
+        payload.push_back(static_cast<char>(buffer[i] ^ sKey[i % 4]));
+
+    return payload;
+};
+
+int main()
+{
+    std::println("MB/s, binary then text frames");
+    std::println("{:>8} {:>16} {:>16} {:>16} {:>16}", "bytes", "bytewise", "unmask", "bytewise UTF-8", "unmaskText");
+
+    for (const size_t size : { 100, 4 * 1024, 1024 * 1024 })
+    {
+        std::vector<uint8_t> masked = makeText(size);
+        WebSocketPayload::unmask(masked, sKey);
+
+        std::vector<uint8_t> buffer(size);
+        const double megabytes = static_cast<double>(size) / (1024.0 * 1024.0);
+
+        const double bytewise = Bench::perSecond([&] {
+            std::memcpy(buffer.data(), masked.data(), size);
+            Bench::keep(unmaskBytewise(buffer));
+        });
+
+        const double unmask = Bench::perSecond([&] {
+            std::memcpy(buffer.data(), masked.data(), size);
+            WebSocketPayload::unmask(buffer, sKey);
+            Bench::keep(buffer);
+        });
+
+        const double bytewiseText = Bench::perSecond([&] {
+            std::memcpy(buffer.data(), masked.data(), size);
+            Bench::keep(validateBytewise(unmaskBytewise(buffer)));
+        });
+
+        const double unmaskText = Bench::perSecond([&] {
+            std::memcpy(buffer.data(), masked.data(), size);
+            WebSocketPayload::Utf8State state{};
+            Bench::keep(WebSocketPayload::unmaskText(buffer, sKey, 0, state) && WebSocketPayload::isComplete(state));
+        });
+
+        std::println("{:>8} {:>16.0f} {:>16.0f} {:>16.0f} {:>16.0f}", size,
+            bytewise * megabytes, unmask * megabytes, bytewiseText * megabytes, unmaskText * megabytes);
+    };
+
+    return 0;
+};